@@ -0,0 +1,341 @@
+#include "physics/particle_system.h"
+#include "physics/snapshot.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef PHYSICS_BENCHMARK_COMMIT
+#define PHYSICS_BENCHMARK_COMMIT "unknown"
+#endif
+
+// Times the phases of ParticleSystem2D::update() over a sweep of particle counts, smoothing radii and thread counts, and writes the
+// results as JSON so runs on different commits can be compared. The simulation runs headless (no window, input or renderer).
+// It also checks that a deterministic run ends in the same state with every thread count, and measures what sleeping saves on a calm scene.
+//
+// Usage: physics-benchmark [--particles 1000,10000,...] [--radii 0.2,0.3] [--threads 1,16] [--iterations N] [--warmup N] [--output file.json]
+//							[--snapshot file]
+// With --snapshot every run starts from the saved (e.g. settled, turbulent) state instead of a grid, and --particles is ignored
+
+// @brief Exposes the protected phases of the particle system so they can be run and timed on their own
+class BenchmarkParticleSystem : public ParticleSystem2D {
+public:
+	using ParticleSystem2D::ParticleSystem2D;
+
+	void prepareBatches() { updateBatchSizes(); }
+	void spatialKeys() { computeSpatialKeys<RenderedParticle2D>(_particles.data()); }
+	void sort() { sortSpatialArrays(); }
+	void startIndices() { computeStartIndices(); }
+	void densities() { calculateParticleDensitiesParallel<RenderedParticle2D>(_particles.data()); }
+	void accelerations() { getAccelerationParallel<RenderedParticle2D>(_acceleration.data(), _particles.data()); }
+	void boundaries() { resolveBoundaryCollisions(); }
+
+	// @brief Only the pressure force sum of each particle, without the rest of the acceleration
+	void pressureForces() {
+		runBatchesParallel("Pressure Batch", [this](int startIndex, int endIndex) {
+			for (int i = startIndex; i < endIndex; i++) {
+				_pressureForces[i] = calculatePressureForce(i, _particles.data(), _densities.data());
+			}
+		});
+	}
+
+	void allocatePressureForces() { _pressureForces.resize(_capacity); }
+
+private:
+	std::vector<glm::vec2> _pressureForces;
+};
+
+struct BenchmarkOptions {
+	std::vector<int> particleCounts{ 1000, 10000, 100000, 1000000 };
+	std::vector<float> smoothingRadii{ 0.2f, 0.3f };
+	std::vector<int> threadCounts{ 1, static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) };
+	int iterations = 5;
+	int warmup = 2;
+	std::string output;
+	std::string snapshot; // Start every run from this snapshot instead of a grid
+};
+
+// @brief Summary of the samples of one phase, in milliseconds
+struct PhaseTiming {
+	std::string name;
+	double min;
+	double median;
+	double mean;
+};
+
+static const float deltaTime = 1.0f / 120.0f;
+
+template<typename T>
+static std::vector<T> parseList(const std::string& text) {
+	std::vector<T> values;
+	std::stringstream stream(text);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		if (!item.empty()) {
+			values.push_back(static_cast<T>(std::stod(item)));
+		}
+	}
+	return values;
+}
+
+static BenchmarkOptions parseOptions(int argc, char** argv) {
+	BenchmarkOptions options{};
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			throw std::runtime_error("Missing value for benchmark option " + arg);
+		}
+		std::string value = argv[++i];
+
+		if (arg == "--particles") options.particleCounts = parseList<int>(value);
+		else if (arg == "--radii") options.smoothingRadii = parseList<float>(value);
+		else if (arg == "--threads") options.threadCounts = parseList<int>(value);
+		else if (arg == "--iterations") options.iterations = std::max(1, std::stoi(value));
+		else if (arg == "--warmup") options.warmup = std::max(0, std::stoi(value));
+		else if (arg == "--output") options.output = value;
+		else if (arg == "--snapshot") options.snapshot = value;
+		else throw std::runtime_error("Unknown benchmark option " + arg);
+	}
+	return options;
+}
+
+template<typename Function>
+static double timeMilliseconds(Function&& function) {
+	auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static PhaseTiming summarize(const std::string& name, std::vector<double> samples) {
+	std::sort(samples.begin(), samples.end());
+	double sum = 0.0;
+	for (double sample : samples) sum += sample;
+	return PhaseTiming{ name, samples.front(), samples[samples.size() / 2], sum / samples.size() };
+}
+
+static GlobalParticleInfo benchmarkParticleInfo(int numParticles) {
+	return GlobalParticleInfo{
+		.defaultColor = { 1.0f, 1.0f, 1.0f, 1.0f },
+		.radius = 0.03f,
+		.spacing = 0.025f,
+		.numParticles = numParticles
+	};
+}
+
+static GlobalPhysicsInfo benchmarkPhysicsInfo(float smoothingRadius) {
+	return GlobalPhysicsInfo{
+		.gravity = 9.8f,
+		.boundaryDampingFactor = 0.9f,
+		.collisionDampingFactor = 0.9f,
+		.densitySmoothingRadius = smoothingRadius,
+		.pressureConstant = 20.f,
+		.restDensity = 5.f,
+		.nSubsteps = 1,
+	};
+}
+
+// @brief A box with room around the initial grid of particles, so the particle density doesn't depend on the particle count
+static BoundingBox benchmarkBox(const GlobalParticleInfo& particleInfo) {
+	float spacing = 2.0f * (particleInfo.radius + particleInfo.spacing);
+	float gridSize = glm::ceil(glm::sqrt(static_cast<float>(particleInfo.numParticles))) * spacing;
+	float halfExtent = 0.75f * gridSize + 1.0f;
+	return BoundingBox{ -halfExtent, halfExtent, -halfExtent, halfExtent };
+}
+
+static std::vector<PhaseTiming> benchmarkPhases(const BenchmarkOptions& options, int numParticles, float smoothingRadius, int threadCount) {
+	GlobalParticleInfo particleInfo = benchmarkParticleInfo(numParticles);
+	GlobalPhysicsInfo physicsInfo = benchmarkPhysicsInfo(smoothingRadius);
+	BoundingBox box = benchmarkBox(particleInfo);
+
+	BenchmarkParticleSystem system(particleInfo, physicsInfo, box);
+	if (!options.snapshot.empty()) {
+		system.loadSnapshot(options.snapshot);
+		physicsInfo.densitySmoothingRadius = smoothingRadius;
+	}
+	system.setThreadCount(threadCount);
+	system.allocatePressureForces();
+
+	// Let the grid settle a little so the neighborhoods aren't perfectly regular
+	for (int i = 0; i < options.warmup; i++) {
+		system.update(deltaTime);
+	}
+	system.prepareBatches();
+
+	std::vector<double> keys, sort, starts, densities, pressure, accelerations, boundaries, update;
+	for (int i = 0; i < options.iterations; i++) {
+		keys.push_back(timeMilliseconds([&]() { system.spatialKeys(); }));
+		sort.push_back(timeMilliseconds([&]() { system.sort(); }));
+		starts.push_back(timeMilliseconds([&]() { system.startIndices(); }));
+		densities.push_back(timeMilliseconds([&]() { system.densities(); }));
+		pressure.push_back(timeMilliseconds([&]() { system.pressureForces(); }));
+		accelerations.push_back(timeMilliseconds([&]() { system.accelerations(); }));
+		boundaries.push_back(timeMilliseconds([&]() { system.boundaries(); }));
+		update.push_back(timeMilliseconds([&]() { system.update(deltaTime); }));
+		system.prepareBatches();
+	}
+
+	return {
+		summarize("spatialKeys", keys),
+		summarize("sortSpatialArrays", sort),
+		summarize("startIndices", starts),
+		summarize("density", densities),
+		summarize("pressureForce", pressure),
+		summarize("acceleration", accelerations),
+		summarize("boundaryCollisions", boundaries),
+		summarize("update", update)
+	};
+}
+
+// @brief Runs the same scene with each integrator and reports how far the mechanical energy drifts from its initial value. The drift is
+//		  absolute, since the initial energy of the resting grid is close to zero
+static void benchmarkIntegrators(std::ostream& json) {
+	const int numParticles = 1600;
+	const int steps = 600;
+	const IntegratorType types[] = { IntegratorType::heun, IntegratorType::leapfrog };
+
+	json << "  \"integrators\": [\n";
+	for (size_t t = 0; t < std::size(types); t++) {
+		GlobalParticleInfo particleInfo = benchmarkParticleInfo(numParticles);
+		GlobalPhysicsInfo physicsInfo = benchmarkPhysicsInfo(0.3f);
+		BoundingBox box = benchmarkBox(particleInfo);
+
+		ParticleSystem2D system(particleInfo, physicsInfo, box);
+		system.setIntegrator(types[t]);
+
+		double initialEnergy = system.mechanicalEnergy();
+		double maxDrift = 0.0;
+		double milliseconds = timeMilliseconds([&]() {
+			for (int i = 0; i < steps; i++) {
+				system.update(deltaTime);
+				maxDrift = std::max(maxDrift, std::abs(system.mechanicalEnergy() - initialEnergy));
+			}
+		});
+		double finalEnergy = system.mechanicalEnergy();
+
+		json << "    { \"integrator\": \"" << system.integratorName() << "\", \"particles\": " << numParticles << ", \"steps\": " << steps
+			<< ", \"msPerStep\": " << milliseconds / steps
+			<< ", \"initialEnergy\": " << initialEnergy << ", \"finalEnergy\": " << finalEnergy
+			<< ", \"energyDrift\": " << finalEnergy - initialEnergy << ", \"maxEnergyDrift\": " << maxDrift << " }"
+			<< (t + 1 < std::size(types) ? "," : "") << "\n";
+	}
+	json << "  ]\n";
+}
+
+// @brief Runs the same deterministic scene with each thread count and checks that every run ends in the same state, bit for bit
+static void benchmarkDeterminism(const BenchmarkOptions& options, std::ostream& json) {
+	const int numParticles = 1600;
+	const int steps = 300;
+
+	json << "  \"determinism\": { \"particles\": " << numParticles << ", \"steps\": " << steps << ", \"runs\": [\n";
+	uint64_t referenceHash = 0;
+	bool reproducible = true;
+	for (size_t t = 0; t < options.threadCounts.size(); t++) {
+		GlobalParticleInfo particleInfo = benchmarkParticleInfo(numParticles);
+		GlobalPhysicsInfo physicsInfo = benchmarkPhysicsInfo(0.3f);
+		BoundingBox box = benchmarkBox(particleInfo);
+
+		ParticleSystem2D system(particleInfo, physicsInfo, box);
+		system.setThreadCount(options.threadCounts[t]);
+		system.setDeterministic(DeterministicSettings{ .enabled = true, .fixedDeltaTime = deltaTime, .seed = 1 });
+		for (int i = 0; i < steps; i++) {
+			system.update();
+		}
+
+		uint64_t hash = system.lastStateHash();
+		if (t == 0) referenceHash = hash;
+		reproducible = reproducible && hash == referenceHash;
+		json << "    { \"threads\": " << options.threadCounts[t] << ", \"stateHash\": \"" << std::hex << hash << std::dec << "\" }"
+			<< (t + 1 < options.threadCounts.size() ? "," : "") << "\n";
+	}
+	json << "  ], \"reproducible\": " << (reproducible ? "true" : "false") << " },\n";
+}
+
+// @brief Runs a calm scene (no gravity, weak pressure) with and without sleeping, and reports the time per step and the fraction of
+//		  particles the force passes still evaluated at the end
+static void benchmarkSleeping(std::ostream& json) {
+	const int numParticles = 4000;
+	const int steps = 600;
+
+	json << "  \"sleeping\": [\n";
+	for (int enabled = 0; enabled < 2; enabled++) {
+		GlobalParticleInfo particleInfo = benchmarkParticleInfo(numParticles);
+		GlobalPhysicsInfo physicsInfo = benchmarkPhysicsInfo(0.3f);
+		physicsInfo.gravity = 0.0f;
+		physicsInfo.pressureConstant = 0.05f;
+		BoundingBox box = benchmarkBox(particleInfo);
+
+		ParticleSystem2D system(particleInfo, physicsInfo, box);
+		system.setSleepSettings(SleepSettings{ .enabled = enabled != 0 });
+		double milliseconds = timeMilliseconds([&]() {
+			for (int i = 0; i < steps; i++) {
+				system.update(deltaTime);
+			}
+		});
+
+		json << "    { \"sleeping\": " << (enabled ? "true" : "false") << ", \"particles\": " << numParticles << ", \"steps\": " << steps
+			<< ", \"msPerStep\": " << milliseconds / steps << ", \"activeFraction\": " << system.activeFraction() << " }"
+			<< (enabled ? "" : ",") << "\n";
+	}
+	json << "  ],\n";
+}
+
+int main(int argc, char** argv) {
+	try {
+		BenchmarkOptions options = parseOptions(argc, argv);
+		if (!options.snapshot.empty()) {
+			options.particleCounts = { Snapshot(options.snapshot).header().numParticles };
+		}
+
+		std::ostringstream json;
+		json.precision(6);
+		json << "{\n";
+		json << "  \"commit\": \"" << PHYSICS_BENCHMARK_COMMIT << "\",\n";
+		json << "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n";
+		json << "  \"iterations\": " << options.iterations << ",\n";
+		json << "  \"results\": [\n";
+
+		size_t numRuns = options.particleCounts.size() * options.smoothingRadii.size() * options.threadCounts.size();
+		size_t run = 0;
+		for (int numParticles : options.particleCounts) {
+			for (float smoothingRadius : options.smoothingRadii) {
+				for (int threadCount : options.threadCounts) {
+					std::cerr << "Benchmarking " << numParticles << " particles, radius " << smoothingRadius << ", " << threadCount << " threads" << std::endl;
+					std::vector<PhaseTiming> phases = benchmarkPhases(options, numParticles, smoothingRadius, threadCount);
+
+					json << "    { \"particles\": " << numParticles << ", \"smoothingRadius\": " << smoothingRadius << ", \"threads\": " << threadCount << ", \"phases\": {\n";
+					for (size_t p = 0; p < phases.size(); p++) {
+						json << "      \"" << phases[p].name << "\": { \"minMs\": " << phases[p].min << ", \"medianMs\": " << phases[p].median
+							<< ", \"meanMs\": " << phases[p].mean << " }" << (p + 1 < phases.size() ? "," : "") << "\n";
+					}
+					json << "    } }" << (++run < numRuns ? "," : "") << "\n";
+				}
+			}
+		}
+		json << "  ],\n";
+
+		benchmarkDeterminism(options, json);
+		benchmarkSleeping(json);
+		benchmarkIntegrators(json);
+		json << "}\n";
+
+		if (options.output.empty()) {
+			std::cout << json.str();
+		}
+		else {
+			std::ofstream file(options.output);
+			if (!file) {
+				throw std::runtime_error("Failed to open benchmark output " + options.output);
+			}
+			file << json.str();
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
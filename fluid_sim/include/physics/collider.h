@@ -0,0 +1,111 @@
+#pragma once
+#include "glm/glm.hpp"
+#include <vector>
+
+struct RenderedParticle2D;
+struct BoundingBox;
+
+// @brief A static shape the particles collide with. Obstacles keep particles outside of them, containers keep particles inside.
+//		  Every collider describes itself with a signed distance field (negative inside the shape) and resolves a whole range of
+//		  particles per call, so the virtual dispatch happens once per batch rather than once per particle
+class Collider {
+public:
+	Collider(bool container = false) : _container(container) {}
+	virtual ~Collider() = default;
+
+	// @brief Signed distance from position to the surface of the shape. Negative inside the shape
+	//
+	// @param position - Point to evaluate the distance field at
+	// @param normal - Filled with the outward unit normal of the closest surface
+	virtual float signedDistance(glm::vec2 position, glm::vec2& normal) const = 0;
+
+	// @brief Pushes the particles in [startIndex, endIndex) out of the collider and reflects the velocity moving into it
+	//
+	// @param particles - Particle array to resolve
+	// @param startIndex - First particle to resolve
+	// @param endIndex - One past the last particle to resolve
+	// @param radius - Radius of the particles
+	// @param damping - Fraction of the normal velocity kept after a bounce
+	virtual void resolve(RenderedParticle2D* particles, int startIndex, int endIndex, float radius, float damping) const = 0;
+
+	inline bool isContainer() const { return _container; }
+
+protected:
+	bool _container;
+};
+
+class BoxCollider final : public Collider {
+public:
+	BoxCollider(glm::vec2 min, glm::vec2 max, bool container = false);
+	BoxCollider(const BoundingBox& box, bool container = true);
+
+	float signedDistance(glm::vec2 position, glm::vec2& normal) const override;
+	void resolve(RenderedParticle2D* particles, int startIndex, int endIndex, float radius, float damping) const override;
+
+private:
+	glm::vec2 _min;
+	glm::vec2 _max;
+};
+
+class CircleCollider final : public Collider {
+public:
+	CircleCollider(glm::vec2 center, float radius, bool container = false);
+
+	float signedDistance(glm::vec2 position, glm::vec2& normal) const override;
+	void resolve(RenderedParticle2D* particles, int startIndex, int endIndex, float radius, float damping) const override;
+
+private:
+	glm::vec2 _center;
+	float _radius;
+};
+
+// @brief A line segment from a to b inflated by radius
+class CapsuleCollider final : public Collider {
+public:
+	CapsuleCollider(glm::vec2 a, glm::vec2 b, float radius, bool container = false);
+
+	float signedDistance(glm::vec2 position, glm::vec2& normal) const override;
+	void resolve(RenderedParticle2D* particles, int startIndex, int endIndex, float radius, float damping) const override;
+
+private:
+	glm::vec2 _a;
+	glm::vec2 _b;
+	float _radius;
+};
+
+// @brief A simple (non self-intersecting) polygon. The vertices can be given in either winding order
+class PolygonCollider final : public Collider {
+public:
+	PolygonCollider(std::vector<glm::vec2> vertices, bool container = false);
+
+	float signedDistance(glm::vec2 position, glm::vec2& normal) const override;
+	void resolve(RenderedParticle2D* particles, int startIndex, int endIndex, float radius, float damping) const override;
+
+private:
+	std::vector<glm::vec2> _vertices;
+};
+
+// @brief A signed distance field sampled on a regular grid and bilinearly interpolated. Baking complex or composite shapes into a grid
+//		  makes their cost per particle constant, no matter how many edges the source shape has
+class SdfGridCollider final : public Collider {
+public:
+	// @param origin - World position of the first sample
+	// @param cellSize - Distance between neighboring samples
+	// @param width - Number of samples along x
+	// @param height - Number of samples along y
+	// @param distances - width*height signed distances, stored row by row
+	SdfGridCollider(glm::vec2 origin, float cellSize, int width, int height, std::vector<float> distances, bool container = false);
+
+	// @brief Samples the signed distance field of source over the region [min, max]
+	static SdfGridCollider bake(const Collider& source, glm::vec2 min, glm::vec2 max, float cellSize);
+
+	float signedDistance(glm::vec2 position, glm::vec2& normal) const override;
+	void resolve(RenderedParticle2D* particles, int startIndex, int endIndex, float radius, float damping) const override;
+
+private:
+	glm::vec2 _origin;
+	float _cellSize;
+	int _width;
+	int _height;
+	std::vector<float> _distances;
+};
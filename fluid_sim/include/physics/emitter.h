@@ -0,0 +1,127 @@
+#pragma once
+#include "glm/glm.hpp"
+#include "physics/collider.h"
+#include <vector>
+#include <memory>
+#include <random>
+
+struct Particle2D;
+
+// @brief Adds particles to a ParticleSystem2D over time. The base class turns the emission rate into a whole number of particles per step
+//		  (carrying the fractional remainder over to the next step), subclasses only decide where the particles appear and how they move
+class Emitter {
+public:
+	// @param rate - Particles emitted per second
+	// @param velocity - Initial velocity of the emitted particles
+	// @param seed - Seed of the emitter's random generator, so the same emitter always produces the same particles
+	Emitter(float rate, glm::vec2 velocity, uint32_t seed = 0);
+	virtual ~Emitter() = default;
+
+	// @brief Appends the particles emitted over deltaTime to spawned
+	//
+	// @return Number of particles appended
+	int emit(float deltaTime, std::vector<Particle2D>& spawned);
+
+	void setRate(float rate) { _rate = rate; }
+	inline float rate() const { return _rate; }
+	void setVelocity(glm::vec2 velocity) { _velocity = velocity; }
+	inline glm::vec2 velocity() const { return _velocity; }
+	void setEnabled(bool enabled) { _enabled = enabled; }
+	inline bool enabled() const { return _enabled; }
+
+protected:
+	float _rate;
+	glm::vec2 _velocity;
+	bool _enabled{ true };
+	float _accumulator{ 0.0f }; // Fraction of a particle left over from the previous steps
+	std::mt19937 _generator;
+
+	// @brief Number of particles per second this emitter actually produces. Defaults to the configured rate
+	virtual float emissionRate() const { return _rate; }
+
+	virtual glm::vec2 samplePosition() = 0;
+	virtual glm::vec2 sampleVelocity() { return _velocity; }
+
+	// @brief Uniform random number in [0, 1)
+	float random();
+};
+
+// @brief Emits every particle from a single point, with the direction spread over a cone around the velocity
+class PointEmitter final : public Emitter {
+public:
+	// @param spread - Half angle of the emission cone in radians
+	PointEmitter(glm::vec2 position, float rate, glm::vec2 velocity, float spread = 0.0f, uint32_t seed = 0);
+
+protected:
+	glm::vec2 samplePosition() override { return _position; }
+	glm::vec2 sampleVelocity() override;
+
+private:
+	glm::vec2 _position;
+	float _spread;
+};
+
+// @brief Emits particles at random points along the segment from a to b
+class LineEmitter final : public Emitter {
+public:
+	LineEmitter(glm::vec2 a, glm::vec2 b, float rate, glm::vec2 velocity, uint32_t seed = 0);
+
+protected:
+	glm::vec2 samplePosition() override;
+
+private:
+	glm::vec2 _a;
+	glm::vec2 _b;
+};
+
+// @brief Emits particles at random points inside the box [min, max]
+class BoxEmitter final : public Emitter {
+public:
+	BoxEmitter(glm::vec2 min, glm::vec2 max, float rate, glm::vec2 velocity, uint32_t seed = 0);
+
+protected:
+	glm::vec2 samplePosition() override;
+
+private:
+	glm::vec2 _min;
+	glm::vec2 _max;
+};
+
+// @brief An inflow boundary along the segment from a to b. Instead of a fixed rate, it emits as many particles as the flow carries
+//		  across the segment: the length of the segment times the normal speed, divided by the area each particle occupies
+class InflowEmitter final : public Emitter {
+public:
+	// @param spacing - Distance between neighboring particles in the incoming flow
+	InflowEmitter(glm::vec2 a, glm::vec2 b, glm::vec2 velocity, float spacing, uint32_t seed = 0);
+
+	void setSpacing(float spacing) { _spacing = spacing; }
+
+protected:
+	float emissionRate() const override;
+	glm::vec2 samplePosition() override;
+
+private:
+	glm::vec2 _a;
+	glm::vec2 _b;
+	float _spacing;
+};
+
+// @brief Removes the particles that enter a region. The region is any collider shape, and a particle is inside it where the shape's
+//		  signed distance is negative (the collider's container flag is ignored)
+class Sink {
+public:
+	Sink(std::unique_ptr<Collider> region) : _region(std::move(region)) {}
+
+	inline bool absorbs(glm::vec2 position) const {
+		glm::vec2 normal;
+		return _region->signedDistance(position, normal) < 0.0f;
+	}
+
+	void setEnabled(bool enabled) { _enabled = enabled; }
+	inline bool enabled() const { return _enabled; }
+	inline const Collider& region() const { return *_region; }
+
+private:
+	std::unique_ptr<Collider> _region;
+	bool _enabled{ true };
+};
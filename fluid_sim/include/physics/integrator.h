@@ -0,0 +1,60 @@
+#pragma once
+#include "glm/glm.hpp"
+#include <vector>
+
+class ParticleSystem2D;
+struct Particle2D;
+
+enum class IntegratorType {
+	heun,
+	leapfrog
+};
+
+// @brief Advances a ParticleSystem2D by one substep. The particle system owns the neighbor search and force evaluation,
+//		  the integrator only decides where (and how many times) forces are evaluated within a step
+class Integrator {
+public:
+	virtual ~Integrator() = default;
+
+	// @brief Advances the positions and velocities of the system's particles by deltaTime
+	virtual void step(ParticleSystem2D& system, float deltaTime) = 0;
+
+	// @brief Discards any state carried between steps (e.g. after the particles are re-arranged)
+	virtual void reset() {}
+
+	// @brief Whether the system's accelerations are carried into the next step, so a snapshot has to keep them to resume exactly
+	virtual bool carriesAccelerations() const { return false; }
+	// @brief Marks the system's accelerations as belonging to the current particles again, after they were restored from a snapshot
+	virtual void restoreAccelerations() {}
+
+	virtual const char* name() const = 0;
+
+	// @brief Scratch memory the integrator keeps per particle
+	virtual size_t bytesPerParticle() const { return 0; }
+};
+
+// @brief Explicit trapezoidal (Heun) scheme. Evaluates forces twice per step: once at the current state and once at an euler-predicted state
+class HeunIntegrator : public Integrator {
+public:
+	void step(ParticleSystem2D& system, float deltaTime) override;
+	const char* name() const override { return "Heun"; }
+	size_t bytesPerParticle() const override;
+
+private:
+	std::vector<Particle2D> _predicted; // Euler-predicted particle state
+	std::vector<glm::vec2> _predictedAcceleration; // Acceleration evaluated at the predicted state
+};
+
+// @brief Kick-drift-kick leapfrog (velocity Verlet). Symplectic, so energy oscillates instead of drifting, and only needs one force
+//		  evaluation per step because the acceleration at the end of a step is reused for the first half-kick of the next
+class LeapfrogIntegrator : public Integrator {
+public:
+	void step(ParticleSystem2D& system, float deltaTime) override;
+	void reset() override { _accelerationValid = false; }
+	bool carriesAccelerations() const override { return _accelerationValid; }
+	void restoreAccelerations() override { _accelerationValid = true; }
+	const char* name() const override { return "Leapfrog"; }
+
+private:
+	bool _accelerationValid{ false }; // Whether the system's accelerations belong to the current positions
+};
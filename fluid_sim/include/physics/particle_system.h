@@ -4,13 +4,19 @@
 #include "utility/timer.h"
 #include "utility/input_manager.h"
 #include "physics/hand.h"
+#include "physics/integrator.h"
+#include "physics/collider.h"
+#include "physics/emitter.h"
 #include <vector>
 #include <iostream>
 #include <cmath>
 #include <iostream>
 #include <future>
+#include <functional>
+#include <memory>
+#include <string>
 
-#define MAX_PARTICLES 50000
+class Snapshot;
 
 struct BoundingBox {
 	float left;
@@ -43,6 +49,46 @@ struct GlobalPhysicsInfo {
 	float pressureConstant;
 	float restDensity;
 	int nSubsteps;
+	bool particleCollisions = false; // Resolve hard collisions between particles after each substep
+};
+
+// @brief Makes runs bit-reproducible: update() ignores the timer and steps by a fixed time, and every random choice is derived from
+//		  the seed, the step number and the particle indices instead of a shared generator
+struct DeterministicSettings {
+	bool enabled = false;
+	float fixedDeltaTime = 1.0f / 120.0f;
+	uint64_t seed = 0;
+};
+
+// @brief Adaptive particle sizes. Particles carry a mass in units of the base particle, and a smoothing length of the global smoothing
+//		  radius times sqrt(mass), so every particle covers an area proportional to its mass. Bulk particles well inside the fluid are
+//		  merged in pairs up to maxMass, and coarse particles that reach the surface are split back in two, so detail is only paid for
+//		  where the fluid has a surface
+struct AdaptivitySettings {
+	bool enabled = false;
+	float maxMass = 4.0f; // Coarsest particles hold this many base particles
+	float splitDensityRatio = 0.75f; // Coarse particles below this fraction of the mean density are near the surface and split
+	float mergeDensityRatio = 0.95f; // Particles above this fraction of the mean density are in the bulk and may merge
+	int interval = 10; // Updates between adaptation passes
+};
+
+// @brief Puts settled regions of the fluid to sleep. After every update each grid cell is marked active if any particle in it moved
+//		  faster than velocityThreshold, or saw its density change by more than densityChangeThreshold (relative to the last update),
+//		  in any of the last calmUpdates updates. Particles with no active cell around them sleep: the force passes skip them, so they
+//		  keep their last density and stay still, but they remain neighbors of the particles around them. An active neighboring cell or
+//		  the interaction hand wakes them up again
+struct SleepSettings {
+	bool enabled = false;
+	float velocityThreshold = 0.05f;
+	float densityChangeThreshold = 0.01f;
+	int calmUpdates = 30; // Updates a particle has to stay below both thresholds before its cell counts as calm
+};
+
+// @brief CPU memory used by the particle system, including the integrator's scratch state
+struct ParticleMemoryFootprint {
+	size_t bytesPerParticle;
+	size_t liveBytes; // Bytes used by the particles currently simulated
+	size_t capacityBytes; // Bytes allocated, including the room to grow
 };
 
 class ParticleSystem2D : public NonCopyable {
@@ -51,68 +97,257 @@ public:
 		GlobalParticleInfo& particleInfo,
 		GlobalPhysicsInfo& physicsInfo,
 		BoundingBox& box,
-		InputManager& inputManager,
+		InputManager* inputManager = nullptr,
 		Hand* hand = nullptr
 	);
 	~ParticleSystem2D();
 
 	// @brief initialize the particles in a grid
 	void arrangeParticles();
-	// @brief Runs every frame and updates the positions of the particles
+	// @brief Runs every frame and updates the positions of the particles by the timer's frame time, or by the fixed time step in
+	//		  deterministic mode
 	void update();
+	// @brief Updates the positions of the particles by deltaTime, independently of the timer
+	void update(float deltaTime);
 
 	void setBoundingBox(BoundingBox box) { _bbox = box; }
 	void setParticleInfo(GlobalParticleInfo particleInfo) { _globalParticleInfo = particleInfo; }
 	void setPhysicsInfo(GlobalPhysicsInfo physicsInfo) { _globalPhysics = physicsInfo; }
 	void setHand(Hand* interactionHand) { _interactionHand = interactionHand; }
 
-	RenderedParticle2D* particles() { return _particles; }
+	// @brief Number of batches the particle passes are split into, each run on its own thread
+	void setThreadCount(int threadCount) { _numThreads = threadCount > 0 ? threadCount : 1; }
+	inline int threadCount() const { return _numThreads; }
+
+	// @brief Adds a static collider that the particles resolve against after the bounding box each substep
+	//
+	// @return Reference to the added collider
+	Collider& addCollider(std::unique_ptr<Collider> collider);
+	void clearColliders() { _colliders.clear(); }
+	inline const std::vector<std::unique_ptr<Collider>>& colliders() const { return _colliders; }
+
+	// @brief Adds an emitter that spawns particles at the start of every update()
+	//
+	// @return Reference to the added emitter
+	Emitter& addEmitter(std::unique_ptr<Emitter> emitter);
+	void clearEmitters() { _emitters.clear(); }
+	inline const std::vector<std::unique_ptr<Emitter>>& emitters() const { return _emitters; }
+
+	// @brief Adds a sink that removes the particles inside it at the start of every update()
+	//
+	// @return Reference to the added sink
+	Sink& addSink(std::unique_ptr<Sink> sink);
+	void clearSinks() { _sinks.clear(); }
+	inline const std::vector<std::unique_ptr<Sink>>& sinks() const { return _sinks; }
+
+	// @brief Appends particles after the live ones, growing the arrays if needed. Stops at the particle limit
+	//
+	// @return Number of particles actually added
+	int spawnParticles(const Particle2D* particles, int count);
+
+	// @brief Emitters stop adding particles once the system holds this many
+	void setParticleLimit(int limit) { _particleLimit = limit; }
+	inline int particleLimit() const { return _particleLimit; }
+	inline int emittedLastUpdate() const { return _emittedLastUpdate; }
+	inline int removedLastUpdate() const { return _removedLastUpdate; }
+
+	// @brief In deterministic mode the state after every step only depends on the initial state, the settings and the inputs, and not
+	//		  on the thread count or the frame times. stateHash() is then recorded after every update()
+	void setDeterministic(DeterministicSettings settings) { _deterministic = settings; }
+	inline const DeterministicSettings& deterministic() const { return _deterministic; }
+
+	// @brief 64-bit FNV-1a hash of the particle count, then the position, velocity and mass bits of every live particle in index order
+	uint64_t stateHash() const;
+	// @brief Hash of the state after the last update() in deterministic mode, 0 otherwise
+	inline uint64_t lastStateHash() const { return _lastStateHash; }
+	// @brief Number of updates simulated since construction
+	inline uint64_t stepCount() const { return _stepCount; }
+
+	// @brief Saves the particles, the particle and physics info, the bounding box and the deterministic state to a snapshot file
+	void saveSnapshot(const std::string& path) const;
+	// @brief Restores the state saved by saveSnapshot(). The particles are copied out of the mapped file in one block, and the
+	//		  particle info, physics info and bounding box structs this system refers to are overwritten
+	void loadSnapshot(const std::string& path);
+	void loadSnapshot(const Snapshot& snapshot);
+
+	// @brief Enables or tunes the splitting and merging of particles. Disabling it keeps the current sizes
+	void setAdaptivity(AdaptivitySettings settings) { _adaptivity = settings; }
+	inline const AdaptivitySettings& adaptivity() const { return _adaptivity; }
+	// @brief Number of particles heavier than the base particle
+	int coarseParticleCount() const;
+	// @brief Sum of the masses, i.e. how many base particles the current particles stand for
+	double totalMass() const;
+
+	// @brief Enables or tunes the sleeping of settled regions. Disabling it wakes every particle
+	void setSleepSettings(SleepSettings settings);
+	inline const SleepSettings& sleepSettings() const { return _sleep; }
+	// @brief Number of particles the force passes evaluated in the last update (every particle while sleeping is disabled)
+	inline int activeParticleCount() const { return _sleep.enabled ? _activeParticles : _globalParticleInfo.numParticles; }
+	// @brief Fraction of the particles that are awake, between 0 and 1
+	float activeFraction() const;
+
+	// @brief Switches the time integration scheme used by update()
+	void setIntegrator(IntegratorType type);
+	IntegratorType integratorType() const { return _integratorType; }
+	const char* integratorName() const { return _integrator->name(); }
+
+	// @brief Rebuilds the spatial lookup for particles, then evaluates the density and acceleration of each of them.
+	//		  This is one full neighbor pass, and the only way integrators should evaluate forces
+	//
+	// @param particles - The particle state to evaluate the forces at
+	// @param outputAccel - Filled with the acceleration of each particle
+	template<typename ParticleType>
+	void computeAccelerations(ParticleType* particles, glm::vec2* outputAccel);
+
+	// @brief Kinetic plus gravitational potential energy of the particles (per unit mass). Used to compare the energy drift of integrators
+	double mechanicalEnergy() const;
+	// @brief Wall-clock duration of the last simulated update(), in milliseconds
+	inline double lastUpdateMilliseconds() const { return _lastUpdateMilliseconds; }
+	// @brief Simulated time of the last update(), in seconds
+	inline float lastDeltaTime() const { return _lastDeltaTime; }
+
+	// @brief Grows the particle arrays so that they hold at least numParticles. Capacity grows geometrically and never shrinks.
+	//		  Pointers returned by particles() and accelerations() are invalidated when the capacity changes
+	void ensureCapacity(int numParticles);
+	inline int capacity() const { return _capacity; }
+	ParticleMemoryFootprint memoryFootprint() const;
+
+	RenderedParticle2D* particles() { return _particles.data(); }
+	const RenderedParticle2D* particles() const { return _particles.data(); }
+	glm::vec2* accelerations() { return _acceleration.data(); }
+	// @brief Densities from the last force evaluation
+	const float* densities() const { return _densities.data(); }
+	// @brief Mass of each particle, in base particles
+	const float* masses() const { return _masses.data(); }
+	// @brief Smoothing length of each particle, relative to the global density smoothing radius
+	const float* smoothingScales() const { return _smoothingScales.data(); }
 	GlobalParticleInfo& particleInfo() { return _globalParticleInfo; }
+	const GlobalParticleInfo& particleInfo() const { return _globalParticleInfo; }
 	GlobalPhysicsInfo& physicsInfo() { return _globalPhysics; }
+	const BoundingBox& boundingBox() const { return _bbox; }
 
 protected:
-	RenderedParticle2D* _particles; // Array of 2D particles
+	std::vector<RenderedParticle2D> _particles; // Array of 2D particles
+	int _capacity; // Number of particles the arrays have room for
 	BoundingBox& _bbox;
 	GlobalParticleInfo& _globalParticleInfo;
 	GlobalPhysicsInfo& _globalPhysics;
-	InputManager& _inputManager;
+	InputManager* _inputManager; // Optional, without it the system doesn't react to user input
 	Hand* _interactionHand;
-	//float** _densities;
-	float* _densities;
-	glm::vec2* _acceleration;
+	std::vector<float> _densities;
+	std::vector<glm::vec2> _acceleration;
+	std::vector<float> _masses; // In base particles
+	std::vector<float> _smoothingScales; // sqrt(mass), the smoothing length is this times the global smoothing radius
 	bool _simulationPaused;
 	bool _doOneFrame;
+	double _lastUpdateMilliseconds;
+	float _lastDeltaTime;
+
+	// Reproducibility
+	DeterministicSettings _deterministic;
+	uint64_t _stepCount;
+	uint64_t _lastStateHash;
 
-	Particle2D* _particles2;
-	// Uncomment for RK4 (slower and didn't have much improvement in terms of stability...)
-	//Particle2D* _particles3;
-	//Particle2D* _particles4;
+	// Obstacles and containers other than the bounding box
+	std::vector<std::unique_ptr<Collider>> _colliders;
+
+	// Time integration
+	std::unique_ptr<Integrator> _integrator;
+	IntegratorType _integratorType;
+	int _lastParticleCount; // Particle count at the end of the last update, to notice counts changed from outside the system
+
+	// Sources and sinks
+	std::vector<std::unique_ptr<Emitter>> _emitters;
+	std::vector<std::unique_ptr<Sink>> _sinks;
+	std::vector<Particle2D> _spawned; // Particles emitted this update, reused between updates
+	int _particleLimit;
+	int _emittedLastUpdate;
+	int _removedLastUpdate;
+
+	// Adaptive sizes
+	AdaptivitySettings _adaptivity;
+	float _maxSmoothingScale; // Largest smoothing scale of any particle, which sets the grid cell size
+	std::vector<uint8_t> _adaptFlags; // Scratch for the adaptation pass
+
+	// Sleeping
+	SleepSettings _sleep;
+	int _activeParticles;
+	std::vector<uint8_t> _sleeping; // Nonzero for particles the force passes skip
+	std::vector<uint16_t> _calmUpdates; // Consecutive updates each particle stayed below the sleep thresholds, saturating
+	std::vector<float> _sleepDensities; // Density of each particle at the last sleep update, to measure its change
+	std::vector<uint8_t> _cellActive; // Activity of each spatial hash key, scratch for the sleep update
 
 	// Compact Hashing
-	uint32_t* _particleIndices;
-	uint32_t* _spatialLookup;
-	uint32_t* _startIndices;
+	float _cellSize; // Grid cell size of the current spatial lookup, the largest smoothing length
+	std::vector<uint32_t> _particleIndices;
+	std::vector<uint32_t> _spatialLookup;
+	std::vector<uint32_t> _startIndices;
 
 	// Concurrency
+	int _numThreads;
 	std::vector<std::future<void>> _futures;
+	std::vector<int> _batchSizes;
+
+	// @brief Removes the particles inside any sink. Each removed particle is replaced by the last live one, so the live particles stay
+	//		  contiguous at the front of the arrays and the neighbor loops and GPU upload never see holes
+	//
+	// @return Number of particles removed
+	int removeAbsorbedParticles();
 
+	// @brief Moves everything stored for particle "from" into slot "to"
+	void moveParticle(int from, int to);
+
+	// @brief Runs the sinks, then the emitters
+	void updateSourcesAndSinks(float deltaTime);
+
+	// @brief Merges pairs of bulk particles and splits coarse surface particles, according to the last densities
+	void adaptParticleSizes();
+	void updateMaxSmoothingScale();
+
+	// @brief Updates the activity of every cell from the particles in it, then puts to sleep or wakes each particle
+	void updateSleepStates();
+	// @brief Wakes every particle and forgets how long they were calm, e.g. when the particles were replaced from outside
+	void wakeAllParticles();
+
+	// @brief Smoothing length shared by two particles, the mean of theirs, so the pair interacts symmetrically
+	inline float pairSmoothingLength(uint32_t a, uint32_t b) const {
+		return 0.5f * (_smoothingScales[a] + _smoothingScales[b]) * _globalPhysics.densitySmoothingRadius;
+	}
+
+	// @brief Divides the particles into one batch per thread
+	void updateBatchSizes();
+
+	// @brief Runs job(startIndex, endIndex) on each batch asynchronously and waits for all of them to finish
+	//
+	// @param zoneName - Profiler zone each batch is recorded under. Must be a string literal
+	void runBatchesParallel(const char* zoneName, const std::function<void(int, int)>& job);
+
+	// @brief Rebuilds the spatial lookup: computes the cell key of each particle, sorts by key, then finds where each cell starts
 	template<typename ParticleType>
 	void updateSpatialLookup(ParticleType* particles);
 
+	template<typename ParticleType>
+	void computeSpatialKeys(ParticleType* particles);
 	void sortSpatialArrays();
+	void computeStartIndices();
 
 	template<typename ParticleType>
 	void loopThroughNearbyPoints(glm::vec2 particlePosition, ParticleType* particles, std::function<void(glm::vec2, uint32_t)> callback);
 
-	// @brief Resolves collisions between particles
+	// Particle collisions
+	std::vector<glm::vec2> _collisionPositionCorrection;
+	std::vector<glm::vec2> _collisionVelocityCorrection;
+
+	// @brief Resolves collisions between particles using the spatial hash. Only finds collisions closer than the density smoothing radius,
+	//		  so the particle diameter must not exceed it
 	void resolveParticleCollisions();
 
-	// @brief Resolves collisions with the bouding box
+	// @brief Resolves collisions with the bounding box and every added collider
 	void resolveBoundaryCollisions();
 
 	// @brief Calculates the density at each particle
 	template<typename ParticleType>
-	void calculateParticleDensitiesParallel(std::vector<int> batchSizes, ParticleType* particles);
+	void calculateParticleDensitiesParallel(ParticleType* particles);
 
 	// @brief Calculates the density at given position
 	template<typename ParticleType>
@@ -122,7 +357,7 @@ protected:
 	template<typename ParticleType>
 	glm::vec2 getAcceleration(uint32_t particleIndex, ParticleType* particles);
 	template<typename ParticleType>
-	void getAccelerationParallel(std::vector<int> batchSizes, glm::vec2* outputAccel, ParticleType* particles);
+	void getAccelerationParallel(glm::vec2* outputAccel, ParticleType* particles);
 
 	template<typename ParticleType>
 	glm::vec2 calculatePressureForce(int particleIndex, ParticleType* particles, float* densities);
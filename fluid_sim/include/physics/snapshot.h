@@ -0,0 +1,64 @@
+#pragma once
+#include "physics/particle_system.h"
+#include "utility/mapped_file.h"
+#include <cstdint>
+#include <string>
+
+// @brief Fixed-size header at the start of a snapshot file. The per-particle arrays follow at their offsets, each stored exactly as
+//		  ParticleSystem2D keeps it in memory, so a mapped snapshot can be read in place or restored with one copy per array.
+//		  Version 2 added the masses and smoothing scales; version 1 files end their header before massOffset and load as unit masses
+struct SnapshotHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder; // byteOrderMark as written by the saving machine
+	uint32_t headerSize; // sizeof(SnapshotHeader) when saved, to catch files from builds with a different layout
+	uint32_t particleSize; // sizeof(RenderedParticle2D) when saved
+	uint64_t particleOffset; // Byte offset of the particle array, a multiple of Snapshot::particleAlignment
+	uint64_t accelerationOffset; // Byte offset of the acceleration array, a multiple of Snapshot::particleAlignment
+	int32_t numParticles;
+	uint32_t integratorType;
+	uint32_t accelerationsValid; // Non-zero if the integrator carried the accelerations into the next step when the snapshot was saved
+	uint64_t stepCount;
+	uint64_t stateHash;
+	GlobalParticleInfo particleInfo;
+	GlobalPhysicsInfo physicsInfo;
+	BoundingBox box;
+	DeterministicSettings deterministic;
+	// Version 2
+	uint64_t massOffset;
+	uint64_t smoothingScaleOffset;
+	AdaptivitySettings adaptivity;
+};
+
+// @brief A snapshot file mapped into memory. The header is validated on open; the particles are only paged in when they are read
+class Snapshot : public NonCopyable {
+public:
+	static constexpr char magic[8] = { 'F', 'L', 'U', 'I', 'D', 'S', 'N', 'P' };
+	static constexpr uint32_t currentVersion = 2;
+	static constexpr uint32_t byteOrderMark = 0x01020304;
+	static constexpr uint64_t particleAlignment = 64;
+
+	// @brief Maps the snapshot at path. Throws if the file isn't a snapshot this build can read
+	Snapshot(const std::string& path);
+
+	inline const SnapshotHeader& header() const { return _header; }
+	// @brief The particles, read straight from the mapping. Valid as long as the snapshot is alive
+	inline const RenderedParticle2D* particles() const {
+		return reinterpret_cast<const RenderedParticle2D*>(_file.data() + _header.particleOffset);
+	}
+	inline const glm::vec2* accelerations() const {
+		return reinterpret_cast<const glm::vec2*>(_file.data() + _header.accelerationOffset);
+	}
+	// @brief Whether the file holds masses and smoothing scales. Older snapshots only hold base particles
+	inline bool hasMasses() const { return _header.version >= 2; }
+	inline const float* masses() const { return reinterpret_cast<const float*>(_file.data() + _header.massOffset); }
+	inline const float* smoothingScales() const { return reinterpret_cast<const float*>(_file.data() + _header.smoothingScaleOffset); }
+
+	// @brief Writes header (filling in the format fields) followed by the numParticles entries of each array to path. Throws on failure
+	static void write(const std::string& path, SnapshotHeader header, const RenderedParticle2D* particles, const glm::vec2* accelerations,
+		const float* masses, const float* smoothingScales);
+
+private:
+	MappedFile _file;
+	SnapshotHeader _header;
+};
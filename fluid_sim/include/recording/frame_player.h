@@ -0,0 +1,50 @@
+#pragma once
+#include "NonCopyable.h"
+#include "recording/frame_stream.h"
+#include "utility/mapped_file.h"
+#include <string>
+#include <vector>
+
+struct RenderedParticle2D;
+
+// @brief Plays back a recording written by FrameRecorder. The file is mapped and decoded one frame at a time, so playback costs the
+//		  decoding of one frame per rendered frame no matter how expensive the recorded simulation was
+class FramePlayer : public NonCopyable {
+public:
+	// @brief Maps the recording at path and indexes its chunks. Throws if it isn't a recording this build can read
+	FramePlayer(const std::string& path);
+
+	// @brief Decodes the next frame, starting over from the first one after the last
+	const RawFrame& nextFrame();
+
+	// @brief Makes frame the next one nextFrame() returns, decoding from the keyframe of its chunk
+	void seek(uint64_t frame);
+
+	// @brief Writes the positions (and velocities, if recorded) of the current frame into particles, colored with color
+	void copyParticles(RenderedParticle2D* particles, glm::vec4 color) const;
+
+	inline const RawFrame& currentFrame() const { return _frame; }
+	inline uint64_t frameCount() const { return _frameCount; }
+	inline uint64_t position() const { return _position; }
+	inline uint32_t channels() const { return _header.channels; }
+	inline const std::string& path() const { return _file.path(); }
+
+private:
+	struct ChunkEntry {
+		const uint8_t* payload;
+		const uint8_t* end;
+		uint32_t numFrames;
+	};
+
+	MappedFile _file;
+	FrameStreamHeader _header;
+	std::vector<ChunkEntry> _chunks;
+	uint64_t _frameCount;
+
+	FrameDecoder _decoder;
+	RawFrame _frame;
+	size_t _chunk; // Chunk the next frame is decoded from
+	uint32_t _frameInChunk;
+	const uint8_t* _cursor;
+	uint64_t _position; // Index of the next frame
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include "NonCopyable.h"
+#include "recording/frame_stream.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class ParticleSystem2D;
+
+struct RecorderSettings {
+	uint32_t channels = 0; // FrameChannel bits recorded on top of the positions
+	uint32_t framesPerChunk = 60; // Frames between keyframes
+	int queueCapacity = 8; // Frames waiting for the I/O thread before new frames are dropped
+	float maxSpeed = 20.0f;
+	float maxDensity = 100.0f;
+};
+
+// @brief Streams the particles of every recorded frame to a file. record() only copies the particles into a free frame slot and queues
+//		  it; a background thread quantizes, delta-encodes and writes the frames in chunks. When the I/O thread falls behind and the queue
+//		  is full, new frames are dropped instead of blocking the simulation. If writing fails, the I/O thread stops and failed() is set;
+//		  the frames recorded until then stay readable
+class FrameRecorder : public NonCopyable {
+public:
+	// @brief Creates the file and starts the I/O thread. Throws if the file can't be created
+	FrameRecorder(const std::string& path, RecorderSettings settings = {});
+	// @brief Writes every queued frame and the last, partial chunk, then closes the file
+	~FrameRecorder();
+
+	// @brief Queues the current particles of system as the next frame
+	//
+	// @param deltaTime - Simulated time since the last recorded frame
+	// @return False if the frame was dropped because the queue was full, or writing failed
+	bool record(const ParticleSystem2D& system, float deltaTime);
+
+	inline const std::string& path() const { return _path; }
+	inline uint64_t framesRecorded() const { return _framesRecorded.load(std::memory_order_relaxed); }
+	inline uint64_t framesDropped() const { return _framesDropped.load(std::memory_order_relaxed); }
+	inline uint64_t bytesWritten() const { return _bytesWritten.load(std::memory_order_relaxed); }
+	// @brief Whether writing failed (disk full, I/O error) and recording stopped
+	inline bool failed() const { return _failed.load(std::memory_order_acquire); }
+	// @brief Why writing failed, empty until failed() is set
+	inline std::string error() const { return failed() ? _error : std::string(); }
+
+private:
+	std::string _path;
+	RecorderSettings _settings;
+	std::ofstream _file;
+	FrameStreamHeader _header;
+
+	// Frames travel from _freeFrames to _queue on the simulation thread and back on the I/O thread, so nothing is allocated per frame
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::deque<std::unique_ptr<RawFrame>> _queue;
+	std::vector<std::unique_ptr<RawFrame>> _freeFrames;
+	bool _stopping;
+
+	uint64_t _nextFrame;
+	float _time;
+	std::atomic<uint64_t> _framesRecorded{ 0 };
+	std::atomic<uint64_t> _framesDropped{ 0 };
+	std::atomic<uint64_t> _bytesWritten{ 0 };
+	std::atomic<bool> _failed{ false };
+	std::string _error; // Written by the I/O thread once, before _failed is set
+
+	std::thread _thread;
+
+	// @brief The I/O thread. Encodes queued frames until stopped and the queue is empty
+	void run();
+	// @return False if the chunk couldn't be written
+	bool writeChunk(const ChunkHeader& header, const std::vector<uint8_t>& payload);
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include "glm/glm.hpp"
+#include <cstdint>
+#include <vector>
+
+// On-disk layout of a recording:
+//	FrameStreamHeader
+//	chunk*: ChunkHeader, then numFrames frames of (FrameHeader, payload)
+// Every channel of a frame is quantized to 16 bits, stored as the difference to the same particle in the previous frame, zigzag
+// encoded and written as a varint. The first frame of every chunk (and any frame whose quantization bounds changed) is a keyframe,
+// stored as the difference to zero, so playback can start at any chunk
+
+inline constexpr char frameStreamMagic[8] = { 'F', 'L', 'U', 'I', 'D', 'R', 'E', 'C' };
+inline constexpr char frameChunkMagic[4] = { 'C', 'H', 'N', 'K' };
+inline constexpr uint32_t frameStreamVersion = 1;
+inline constexpr uint32_t frameStreamByteOrder = 0x01020304;
+
+// @brief Optional per-particle channels. Positions are always recorded
+enum FrameChannel : uint32_t {
+	frameChannelVelocity = 1 << 0,
+	frameChannelDensity = 1 << 1
+};
+
+struct FrameStreamHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t channels; // FrameChannel bits
+	uint32_t framesPerChunk;
+	float maxSpeed; // Velocities are quantized over [-maxSpeed, maxSpeed]
+	float maxDensity; // Densities are quantized over [0, maxDensity]
+};
+
+struct ChunkHeader {
+	char magic[4];
+	uint32_t numFrames;
+	uint64_t firstFrame;
+	uint64_t payloadBytes; // Bytes of frames following the chunk header
+};
+
+struct FrameHeader {
+	uint64_t frame;
+	float time;
+	int32_t numParticles;
+	uint32_t keyframe;
+	uint32_t payloadBytes;
+	glm::vec2 boundsMin; // Positions are quantized over the bounds of the frame
+	glm::vec2 boundsMax;
+};
+
+// @brief Uncompressed particle data of one frame, as handed from the simulation to the recorder and from the player to the renderer
+struct RawFrame {
+	uint64_t frame = 0;
+	float time = 0.0f;
+	int numParticles = 0;
+	glm::vec2 boundsMin{ 0.0f };
+	glm::vec2 boundsMax{ 0.0f };
+	std::vector<glm::vec2> positions;
+	std::vector<glm::vec2> velocities;
+	std::vector<float> densities;
+};
+
+// @brief Quantizes and delta-encodes frames against the previous frame it encoded
+class FrameEncoder {
+public:
+	FrameEncoder(const FrameStreamHeader& header) : _header(header) {}
+
+	// @brief Appends the frame header and payload of frame to output
+	//
+	// @param keyframe - Encode against zero instead of the previous frame
+	void encode(const RawFrame& frame, bool keyframe, std::vector<uint8_t>& output);
+
+private:
+	FrameStreamHeader _header;
+	std::vector<uint16_t> _previous; // Quantized components of the previous frame, interleaved per particle so the count can change
+	glm::vec2 _previousMin{ 0.0f };
+	glm::vec2 _previousMax{ 0.0f };
+};
+
+// @brief Decodes the frames written by FrameEncoder, in the order they were encoded
+class FrameDecoder {
+public:
+	FrameDecoder(const FrameStreamHeader& header) : _header(header) {}
+
+	// @brief Decodes the frame starting at data into frame
+	//
+	// @return Pointer just past the frame. Throws if the frame runs past end
+	const uint8_t* decode(const uint8_t* data, const uint8_t* end, RawFrame& frame);
+
+private:
+	FrameStreamHeader _header;
+	std::vector<uint16_t> _previous;
+};
+
+// @brief Number of 16-bit components recorded per particle with the given channels
+uint32_t componentsPerParticle(uint32_t channels);
@@ -8,22 +8,48 @@
 #include "renderer/command.h"
 #include "physics/particle_system.h"
 
+#include <future>
 #include <vector>
 
+// @brief Push constants of the particle draw: the bindless table slots of the buffers the particle shaders read. Matches the
+//		  DrawIndices block of circle.vert
+struct ParticleDrawIndices {
+	uint32_t particles; // RenderedParticle2D array
+};
+
 class ParticleRenderSystem : public RenderSystem {
 public:
-	ParticleRenderSystem(Renderer& renderer, std::vector<VkDescriptorSetLayout> particleDescriptorLayout, std::vector<VkDescriptorSet> particleDescriptorSets, ParticleSystem2D& particleSystem);
+	// @param drawIndices - Slots of the particle buffers in the renderer's bindless table. A buffer may be replaced, but must stay in its slot.
+	//						The camera and the particle info are per-frame constants in the renderer's upload heap instead
+	// @param buildAsync - Compile the pipeline on a background thread. Until it is ready, frames show only the clear color (and the GUI)
+	ParticleRenderSystem(Renderer& renderer, ParticleDrawIndices drawIndices, ParticleSystem2D& particleSystem, bool buildAsync = false);
+	// @brief Stops listening for shader changes
+	~ParticleRenderSystem();
 
 	void render(Command& cmd);
+	const char* name() const override { return "Particles"; }
+
+	// @brief Sets the dynamic offset of this frame's GlobalUBO, pushed to the renderer's upload heap
+	inline void setGlobals(uint32_t offset) { _globalsOffset = offset; }
+	// @brief Sets how many particles of the particle buffer this frame draws. It follows the buffer's contents, which during playback
+	//		  are the recording's particles rather than the particle system's
+	inline void setParticleCount(int count) { _particleCount = count; }
+
+	// @brief Whether the particle pipeline has been built, i.e. whether particles are drawn
+	inline bool pipelinesReady() const { return !_pipelines.empty(); }
 
-	void bindDescriptor(VkDescriptorSet set);
+	// @brief Directory of the particle shaders, GLSL sources and their SPIR-V
+	static std::string shaderDirectory();
 
 private:
 	ParticleSystem2D& _particleSystem;
 
 	std::vector<Pipeline> _pipelines;
-	std::vector<VkDescriptorSetLayout> _particleDescriptors;
-	std::vector<VkDescriptorSet> _particleSet;
+	std::future<Pipeline> _pendingPipeline; // Pipeline being built in the background
+	uint32_t _shaderListener; // Rebuilds the pipeline when the shaders are hot reloaded
+	ParticleDrawIndices _drawIndices;
+	uint32_t _globalsOffset;
+	int _particleCount;
 
-	void buildPipeline();
+	void buildPipeline(bool buildAsync);
 };
\ No newline at end of file
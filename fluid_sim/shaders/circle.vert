@@ -1,5 +1,6 @@
 #version 450
 #extension GL_KHR_vulkan_glsl : enable
+#extension GL_EXT_nonuniform_qualifier : require
 
 const int NUM_OFFSETS = 6;
 const vec2 OFFSETS[6] = vec2[](
@@ -17,37 +18,48 @@ struct Particle2D {
 	vec4 color;
 };
 
+// The particle buffer is an element of the engine's bindless storage buffer array (set 0, binding 0), the push constants
+// say which one
+layout (push_constant) uniform DrawIndices {
+	uint particles;
+} indices;
+
+layout (set = 0, binding = 0) readonly buffer ParticleData {
+	Particle2D particles[];
+} particleBuffers[];
+
+// Per-frame constants from the engine's upload heap (set 1), placed by dynamic offsets
 layout (set = 1, binding = 0) uniform GlobalUBO {
 	mat4 projection;
 	mat4 view;
 	float aspectRatio;
 } globalBuffer;
 
-layout(location = 0) out vec4 fragColor;
-layout(location = 1) out vec2 fragOffset;
-
-layout (set = 0, binding = 0) uniform GlobalParticleInfo {
+layout (set = 1, binding = 1) uniform GlobalParticleInfo {
 	vec4 defaultColor;
 	float radius;
+	float spacing;
 	int numParticles;
 } globalParticleInfo;
 
-layout (set = 0, binding = 1) readonly buffer ParticleData {
-	Particle2D particles[];
-} particleData;
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragOffset;
 
 
 void main() 
 {
-	int particleIndex = gl_VertexIndex / NUM_OFFSETS;
+	mat4 view = globalBuffer.view;
+	mat4 projection = globalBuffer.projection;
+	float radius = globalParticleInfo.radius;
+	Particle2D particle = particleBuffers[indices.particles].particles[gl_VertexIndex / NUM_OFFSETS];
+
 	fragOffset = OFFSETS[gl_VertexIndex % NUM_OFFSETS];
-	vec3 cameraRightWorld = {globalBuffer.view[0][0], globalBuffer.view[1][0], globalBuffer.view[2][0]};
-	vec3 cameraUpWorld = {globalBuffer.view[0][1], globalBuffer.view[1][1], globalBuffer.view[2][1]};
-	//fragColor = particleData.particles[particleIndex].color;
-	fragColor = particleData.particles[particleIndex].color;
-	vec3 worldPosition = vec3(particleData.particles[particleIndex].position, 0.0);
+	vec3 cameraRightWorld = {view[0][0], view[1][0], view[2][0]};
+	vec3 cameraUpWorld = {view[0][1], view[1][1], view[2][1]};
+	fragColor = particle.color;
+	vec3 worldPosition = vec3(particle.position, 0.0);
 	worldPosition = worldPosition.xyz 
-		+ globalParticleInfo.radius * fragOffset.x * cameraRightWorld 
-		+ globalParticleInfo.radius * fragOffset.y * cameraUpWorld;
-	gl_Position = globalBuffer.projection * globalBuffer.view * vec4(worldPosition, 1.0);
+		+ radius * fragOffset.x * cameraRightWorld 
+		+ radius * fragOffset.y * cameraUpWorld;
+	gl_Position = projection * view * vec4(worldPosition, 1.0);
 }
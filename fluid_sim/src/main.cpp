@@ -8,11 +8,14 @@
 #include "utility/timer.h"
 #include "utility/gui.h"
 #include "utility/input_manager.h"
+#include "utility/profiler.h"
 #include "renderer/renderer.h"
 #include "renderer/descriptor.h"
 #include "renderer/buffer.h"
 #include "physics/particle_system.h"
 #include "physics/hand.h"
+#include "recording/frame_recorder.h"
+#include "recording/frame_player.h"
 #include "render_systems/particle_render_system.h"
 #include "render_systems/render_system.h"
 #include "render_systems/gui_render_system.h"
@@ -24,6 +27,7 @@ static const uint32_t APPLICATION_WIDTH = 1920;
 static const uint32_t APPLICATION_HEIGHT = 1080;
 
 static const float coordinateScale = 4.5;
+static const int maxGuiParticles = 2000000; // Only limits the GUI slider, the particle system grows to fit any count
 
 struct GlobalUBO {
 	glm::mat4 projection;
@@ -31,7 +35,83 @@ struct GlobalUBO {
 	float aspectRatio;
 };
 
+struct CommandLineOptions {
+	int captureFrames = 0; // Frames to capture into a trace right after startup, 0 for none
+	std::string capturePath = "profile_capture.json";
+	bool deterministic = false; // Step by a fixed time with seeded randomness, so runs can be compared bit for bit
+	uint64_t seed = 0;
+	std::string loadSnapshot; // Snapshot to resume from instead of the initial grid
+	std::string recordPath; // Stream every simulated frame to this file
+	std::string playPath; // Play this recording instead of simulating
+	bool asyncPipelines = false; // Compile the particle pipeline in the background, showing empty frames until it's ready
+	bool hotReload = false; // Watch the shader directory and rebuild the particle pipeline when a shader is saved
+};
+
+static const char* commandLineUsage =
+	"Usage: 2d-fluid-sim [flags]\n"
+	"  --capture-frames N    Capture the first N frames with the profiler and write them as a Chrome trace\n"
+	"  --capture-path FILE   Where to write the trace (and F9 captures), default profile_capture.json\n"
+	"  --deterministic SEED  Run the simulation in deterministic mode with the given seed\n"
+	"  --load-snapshot FILE  Resume the simulation from a snapshot saved with the Snapshot widget\n"
+	"  --record FILE         Record the positions, velocities and densities of every simulated frame\n"
+	"  --play FILE           Play back a recording in a loop instead of simulating\n"
+	"  --async-pipelines     Compile the particle pipeline on a background thread while the first frames render\n"
+	"  --hot-reload          Recompile and swap in the particle shaders when their GLSL or SPIR-V files change\n";
+
+// @brief Parses the command line flags listed in commandLineUsage. Throws on an unknown flag, a missing value or a value that isn't a number
+static CommandLineOptions parseCommandLine(int argc, char* argv[]) {
+	CommandLineOptions options{};
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		try {
+			if (arg == "--capture-frames" && i + 1 < argc) {
+				options.captureFrames = std::stoi(argv[++i]);
+			}
+			else if (arg == "--capture-path" && i + 1 < argc) {
+				options.capturePath = argv[++i];
+			}
+			else if (arg == "--deterministic" && i + 1 < argc) {
+				options.deterministic = true;
+				options.seed = std::stoull(argv[++i]);
+			}
+			else if (arg == "--load-snapshot" && i + 1 < argc) {
+				options.loadSnapshot = argv[++i];
+			}
+			else if (arg == "--record" && i + 1 < argc) {
+				options.recordPath = argv[++i];
+			}
+			else if (arg == "--play" && i + 1 < argc) {
+				options.playPath = argv[++i];
+			}
+			else if (arg == "--async-pipelines") {
+				options.asyncPipelines = true;
+			}
+			else if (arg == "--hot-reload") {
+				options.hotReload = true;
+			}
+			else {
+				throw std::runtime_error("Unknown or incomplete command line flag: " + arg);
+			}
+		}
+		catch (const std::logic_error&) {
+			// std::stoi and std::stoull throw invalid_argument or out_of_range, which only name the function
+			throw std::runtime_error("Invalid value for command line flag " + arg + ": " + argv[i]);
+		}
+	}
+	return options;
+}
+
 int main(int argc, char* argv[]) {
+	auto launchTime = std::chrono::steady_clock::now(); // Startup is reported once the first frame is submitted
+	CommandLineOptions options;
+	try {
+		options = parseCommandLine(argc, argv);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl << commandLineUsage;
+		return EXIT_FAILURE;
+	}
+
 	// Initialize the renderer, window and input manager
 	//Application* app = new Application();
 	Application* app = new Application(APPLICATION_WIDTH, APPLICATION_HEIGHT, "2D Fluid Simulator");
@@ -44,16 +124,8 @@ int main(int argc, char* argv[]) {
 		
 		static Timer& timer = Timer::getTimer();
 		static Gui& gui = Gui::getGui();
-
-		// Initialize the rendering descriptor pool
-		std::vector<PoolSizeRatio> renderDescriptorSetSizes = {
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 10},
-			//{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 10},
-			{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10},
-			//{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 10},
-			//{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 10}
-		};
-		DescriptorPool globalDescriptorPool(app->renderer().device(), 10, renderDescriptorSetSizes);
+		static Profiler& profiler = Profiler::getProfiler();
+		profiler.setThreadName("Main");
 
 		float particleColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
 
@@ -82,31 +154,46 @@ int main(int argc, char* argv[]) {
 		Hand mouseInteraction(handRadius, interactionStrength, coordinateScale);
 
 		// The constructor of the particle system initializes the positions of the particles to a grid
-		ParticleSystem2D fluidParticles(particleInfo, physicsInfo, box, app->inputManager(), &mouseInteraction);
-
-		// We will use a uniform buffer for the global particle info 
-		Buffer globalParticleBuffer(app->renderer().device(), app->renderer().allocator(), sizeof(GlobalParticleInfo), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, app->renderer().device().physicalDeviceProperies().limits.minUniformBufferOffsetAlignment);
-		globalParticleBuffer.map();
-
-		// For the actual particle info, we want to use a storage buffer
-		Buffer particleBuffer(app->renderer().device(), app->renderer().allocator(), sizeof(Particle2D) * MAX_PARTICLES, 1, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, app->renderer().device().physicalDeviceProperies().limits.minStorageBufferOffsetAlignment);
-		particleBuffer.map();
-
-		Buffer globalBuffer(app->renderer().device(), app->renderer().allocator(), sizeof(GlobalUBO), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, app->renderer().device().physicalDeviceProperies().limits.minUniformBufferOffsetAlignment);
-		globalBuffer.map();
-
-		VkDescriptorSetLayout particleLayouts = app->renderer().descriptorLayoutBuilder().addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS).addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS).build();
-		VkDescriptorSet particleDescriptor = globalDescriptorPool.allocateDescriptorSet(particleLayouts);
-		app->renderer().descriptorWriter().addBufferWrite(0, globalParticleBuffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER).addBufferWrite(1, particleBuffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER).updateDescriptorSet(particleDescriptor).clear();
-		app->renderer().descriptorLayoutBuilder().clear();
+		ParticleSystem2D fluidParticles(particleInfo, physicsInfo, box, &app->inputManager(), &mouseInteraction);
+		fluidParticles.setDeterministic(DeterministicSettings{ .enabled = options.deterministic, .seed = options.seed });
+		if (!options.loadSnapshot.empty()) {
+			fluidParticles.loadSnapshot(options.loadSnapshot);
+		}
 
-		VkDescriptorSetLayout globalLayout = app->renderer().descriptorLayoutBuilder().addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS).build();
-		VkDescriptorSet globalDescriptor = globalDescriptorPool.allocateDescriptorSet(globalLayout);
-		app->renderer().descriptorWriter().addBufferWrite(0, globalBuffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER).updateDescriptorSet(globalDescriptor).clear();
+		// The shaders reach the particle buffer through the renderer's bindless table, by the slot index it is registered at.
+		// The camera and the global particle info are per-frame constants, pushed to the renderer's upload heap every frame
+		BindlessTable& bindlessTable = app->renderer().bindlessTable();
+		ParticleDrawIndices drawIndices{ .particles = 0 };
+
+		// For the actual particle info, we want to use a storage buffer. It is sized to the particle system's capacity and
+		// reallocated (and rewritten into its bindless slot) whenever the particle system grows past it
+		// Playback can hold more particles than the simulation, so the buffer fits whichever is larger
+		std::unique_ptr<Buffer> particleBuffer;
+		auto ensureParticleBufferCapacity = [&](int numParticles) {
+			int count = std::max(numParticles, fluidParticles.capacity());
+			size_t requiredSize = sizeof(RenderedParticle2D) * count;
+			if (particleBuffer && particleBuffer->bufferSize() >= requiredSize) return;
+
+			// Frames in flight may still read the old buffer through the slot that is about to be rewritten
+			app->renderer().waitForIdle();
+			bool firstAllocation = !particleBuffer;
+			particleBuffer = std::make_unique<Buffer>(app->renderer().device(), app->renderer().allocator(), sizeof(RenderedParticle2D), count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, app->renderer().device().physicalDeviceProperies().limits.minStorageBufferOffsetAlignment);
+			particleBuffer->map();
+			if (firstAllocation) {
+				drawIndices.particles = bindlessTable.addStorageBuffer(*particleBuffer);
+			}
+			else {
+				bindlessTable.writeStorageBuffer(drawIndices.particles, *particleBuffer);
+			}
+		};
+		ensureParticleBufferCapacity(0);
 
 		// Create the render systems and add them to the renderer
-		ParticleRenderSystem particleRenderSystem(app->renderer(), std::vector<VkDescriptorSetLayout>{particleLayouts, globalLayout}, std::vector<VkDescriptorSet>{particleDescriptor, globalDescriptor}, fluidParticles);
+		ParticleRenderSystem particleRenderSystem(app->renderer(), drawIndices, fluidParticles, options.asyncPipelines);
 		app->renderer().addRenderSystem(&particleRenderSystem);
+		if (options.hotReload) {
+			app->renderer().shaderHotReloader().watch(ParticleRenderSystem::shaderDirectory());
+		}
 
 		// Set up the camera
 		Camera camera{};
@@ -116,29 +203,67 @@ int main(int argc, char* argv[]) {
 		GuiRenderSystem guiRenderSystem(app->renderer(), app->window());
 		app->renderer().addRenderSystem(&guiRenderSystem);
 
+		// F9 captures the next few seconds of frames for offline analysis
+		static const int hotkeyCaptureFrames = 120;
+		app->inputManager().addListener(InputEvent::f9Down, [&]() {
+			profiler.startCapture(hotkeyCaptureFrames, options.capturePath);
+		});
+		profiler.startCapture(options.captureFrames, options.capturePath);
+
 		logger.print("Starting the main loop!");
 
 		// Start physics when this becomes true;
-		bool letThereBeLight = false;
+		bool letThereBeLight = !options.loadSnapshot.empty(); // A loaded snapshot must not be replaced by the initial grid
+		char snapshotPath[256] = "snapshot.fsnap";
+		std::string snapshotStatus;
+
+		// Recording and playback. While playing, the simulation is left untouched and the recording's particles are uploaded and drawn
+		// instead. Their count is only the draw's, the simulation's GlobalParticleInfo keeps its own
+		std::unique_ptr<FrameRecorder> recorder;
+		std::unique_ptr<FramePlayer> player;
+		std::vector<RenderedParticle2D> playbackParticles;
+		uint64_t lastRecordedStep = fluidParticles.stepCount();
+		char recordingPath[256] = "recording.frec";
+		std::string recordingStatus;
+		RecorderSettings recorderSettings{ .channels = frameChannelVelocity | frameChannelDensity };
+		if (!options.recordPath.empty()) {
+			recorder = std::make_unique<FrameRecorder>(options.recordPath, recorderSettings);
+		}
+		if (!options.playPath.empty()) {
+			player = std::make_unique<FramePlayer>(options.playPath);
+		}
+		bool obstaclesEnabled = false;
+		bool sourcesEnabled = false;
+		float inflowSpeed = 2.0f;
+		float fountainRate = 100.0f;
+		fluidParticles.setParticleLimit(maxGuiParticles);
 		glm::vec2 mousePosition;
+		bool firstFrame = true;
 
 		// Main application loop
 		while (!app->window().shouldClose()) {
 			app->inputManager().processInputs(); // Poll the user inputs
 			if (app->window().pauseRendering()) {
 				std::this_thread::sleep_for(std::chrono::milliseconds(100));
-				timer.update(); // Updating the timer here too so there are no large jumps in timer updates
+				timer.update(false); // Updating the timer here too so there are no large jumps in timer updates
 				continue;
 			}
 
 			timer.update();
+			profiler.newFrame(); // Collect the zones of the previous frame
 			guiRenderSystem.getNewFrame();
+			profiler.addWidgets();
+			timer.statistics().addWidgets();
 
 			// Timer Info Display
 			gui.addWidget("Info", [&]() {
 				ImGui::Text("FrameTime: %.8f ms", timer.frameTime());
 				ImGui::Text("FPS: %.2f", timer.framesPerSecond());
 				ImGui::Text("Mouse Position: (%.2f, %.2f)", mousePosition.x, mousePosition.y);
+				DescriptorAllocatorStatistics descriptors = app->renderer().descriptorAllocator().statistics();
+				DescriptorAllocatorStatistics frameDescriptors = app->renderer().frameDescriptors().statistics();
+				ImGui::Text("Descriptor Pools: %u (%u sets, %u exhausted)", descriptors.pools, descriptors.setsAllocated, descriptors.poolsExhausted);
+				ImGui::Text("Frame Descriptor Pools: %u (%u sets, %u exhausted)", frameDescriptors.pools, frameDescriptors.setsAllocated, frameDescriptors.poolsExhausted);
 				});
 
 			gui.addWidget("Controls", [&]() {
@@ -154,8 +279,13 @@ int main(int argc, char* argv[]) {
 			gui.addWidget("Particle Info", [&]() {
 				ImGui::DragFloat("Radius", &particleInfo.radius, 0.001, 0.0f, 1000000.0f);
 				ImGui::DragFloat("Spacing", &particleInfo.spacing, 0.001, 0.0f, 1000000.0f);
-				ImGui::DragInt("# Particles", &particleInfo.numParticles, 1, 0, MAX_PARTICLES);
+				ImGui::DragInt("# Particles", &particleInfo.numParticles, 1, 0, maxGuiParticles);
 				ImGui::ColorEdit4("Default Color", particleInfo.defaultColor);
+				ParticleMemoryFootprint footprint = fluidParticles.memoryFootprint();
+				ImGui::Text("Capacity: %d", fluidParticles.capacity());
+				ImGui::Text("Memory: %zu B/particle, %.2f MB live, %.2f MB allocated", footprint.bytesPerParticle,
+					footprint.liveBytes / (1024.0 * 1024.0), footprint.capacityBytes / (1024.0 * 1024.0));
+				ImGui::Text("GPU Buffer: %.2f MB", particleBuffer->bufferSize() / (1024.0 * 1024.0));
 				});
 
 			// Physics Info Display
@@ -163,10 +293,148 @@ int main(int argc, char* argv[]) {
 				ImGui::DragFloat("Gravity", &physicsInfo.gravity, 0.01, 0.0f, 1000000.0f);
 				ImGui::DragFloat("Boundary Damping", &physicsInfo.boundaryDampingFactor, 0.001, 0.0f, 1.0f);
 				ImGui::DragFloat("Collision Damping", &physicsInfo.collisionDampingFactor, 0.001, 0.0f, 1.0f);
+				ImGui::Checkbox("Particle Collisions", &physicsInfo.particleCollisions);
 				ImGui::DragFloat("Density Smoothing", &physicsInfo.densitySmoothingRadius, 0.001, 0.01f, 10.f);
 				ImGui::DragFloat("Pressure Constant", &physicsInfo.pressureConstant, 0.01, 0.01f, 1000.f);
 				ImGui::DragFloat("Rest Density", &physicsInfo.restDensity, 0.01, 0.01f, 10000.f);
 				ImGui::DragInt("# Substeps", &physicsInfo.nSubsteps, 1, 1, 100);
+				int integrator = static_cast<int>(fluidParticles.integratorType());
+				if (ImGui::Combo("Integrator", &integrator, "Heun\0Leapfrog\0")) {
+					fluidParticles.setIntegrator(static_cast<IntegratorType>(integrator));
+				}
+				ImGui::Text("Update Time: %.3f ms", fluidParticles.lastUpdateMilliseconds());
+				ImGui::Text("Mechanical Energy: %.4f", fluidParticles.mechanicalEnergy());
+
+				AdaptivitySettings adaptivity = fluidParticles.adaptivity();
+				bool adaptivityChanged = ImGui::Checkbox("Adaptive Sizes", &adaptivity.enabled);
+				if (adaptivity.enabled) {
+					adaptivityChanged |= ImGui::DragFloat("Max Mass", &adaptivity.maxMass, 0.1f, 1.0f, 64.0f);
+					adaptivityChanged |= ImGui::DragFloat("Split Density Ratio", &adaptivity.splitDensityRatio, 0.01f, 0.0f, 1.0f);
+					adaptivityChanged |= ImGui::DragFloat("Merge Density Ratio", &adaptivity.mergeDensityRatio, 0.01f, 0.0f, 2.0f);
+					adaptivityChanged |= ImGui::DragInt("Adapt Interval", &adaptivity.interval, 1, 1, 1000);
+					ImGui::Text("Coarse Particles: %d, Total Mass: %.0f", fluidParticles.coarseParticleCount(), fluidParticles.totalMass());
+				}
+				if (adaptivityChanged) {
+					fluidParticles.setAdaptivity(adaptivity);
+				}
+
+				SleepSettings sleep = fluidParticles.sleepSettings();
+				bool sleepChanged = ImGui::Checkbox("Sleeping", &sleep.enabled);
+				if (sleep.enabled) {
+					sleepChanged |= ImGui::DragFloat("Sleep Velocity", &sleep.velocityThreshold, 0.001f, 0.0f, 10.0f, "%.3f");
+					sleepChanged |= ImGui::DragFloat("Sleep Density Change", &sleep.densityChangeThreshold, 0.0001f, 0.0f, 1.0f, "%.4f");
+					sleepChanged |= ImGui::DragInt("Calm Updates", &sleep.calmUpdates, 1, 0, 1000);
+				}
+				if (sleepChanged) {
+					fluidParticles.setSleepSettings(sleep);
+				}
+				ImGui::Text("Active Particles: %d (%.1f%%)", fluidParticles.activeParticleCount(), 100.0f * fluidParticles.activeFraction());
+
+				DeterministicSettings deterministic = fluidParticles.deterministic();
+				bool changed = ImGui::Checkbox("Deterministic", &deterministic.enabled);
+				if (deterministic.enabled) {
+					changed |= ImGui::DragFloat("Fixed Time Step", &deterministic.fixedDeltaTime, 0.0001f, 0.0001f, 0.1f, "%.4f");
+					const uint64_t seedStep = 1; // Shows the +/- buttons
+					changed |= ImGui::InputScalar("Seed", ImGuiDataType_U64, &deterministic.seed, &seedStep);
+					ImGui::Text("Step %llu, state hash %016llx", static_cast<unsigned long long>(fluidParticles.stepCount()),
+						static_cast<unsigned long long>(fluidParticles.lastStateHash()));
+				}
+				if (changed) {
+					fluidParticles.setDeterministic(deterministic);
+				}
+				});
+
+			// Obstacles aren't drawn yet, the particles just flow around them
+			gui.addWidget("Colliders", [&]() {
+				if (ImGui::Checkbox("Obstacles", &obstaclesEnabled)) {
+					fluidParticles.clearColliders();
+					if (obstaclesEnabled) {
+						fluidParticles.addCollider(std::make_unique<CircleCollider>(glm::vec2{ -3.0f, 0.0f }, 0.75f));
+						fluidParticles.addCollider(std::make_unique<CapsuleCollider>(glm::vec2{ 0.0f, -2.0f }, glm::vec2{ 2.0f, -1.0f }, 0.25f));
+						// Bake the polygon into a distance grid so its cost doesn't grow with its number of edges
+						PolygonCollider triangle({ { 2.5f, 1.0f }, { 4.5f, 1.0f }, { 3.5f, 2.5f } });
+						fluidParticles.addCollider(std::make_unique<SdfGridCollider>(SdfGridCollider::bake(triangle, { 2.0f, 0.5f }, { 5.0f, 3.0f }, 0.05f)));
+					}
+				}
+				ImGui::Text("Colliders: %d", static_cast<int>(fluidParticles.colliders().size()));
+				});
+
+			// An inflow on the left wall, a fountain at the top and an outflow sink on the right wall
+			gui.addWidget("Sources", [&]() {
+				if (ImGui::Checkbox("Emitters and Sinks", &sourcesEnabled)) {
+					fluidParticles.clearEmitters();
+					fluidParticles.clearSinks();
+					if (sourcesEnabled) {
+						float inset = 2.0f * particleInfo.radius;
+						fluidParticles.addEmitter(std::make_unique<InflowEmitter>(glm::vec2{ box.left + inset, box.bottom + 1.0f }, glm::vec2{ box.left + inset, box.bottom + 3.0f },
+							glm::vec2{ inflowSpeed, 0.0f }, 2.0f * (particleInfo.radius + particleInfo.spacing), 1));
+						fluidParticles.addEmitter(std::make_unique<PointEmitter>(glm::vec2{ 0.0f, box.top - 0.5f }, fountainRate, glm::vec2{ 0.0f, -2.0f }, 0.3f, 2));
+						fluidParticles.addSink(std::make_unique<Sink>(std::make_unique<BoxCollider>(glm::vec2{ box.right - 0.5f, box.bottom }, glm::vec2{ box.right, box.top })));
+					}
+				}
+				if (sourcesEnabled) {
+					if (ImGui::DragFloat("Inflow Speed", &inflowSpeed, 0.01f, 0.0f, 100.0f)) {
+						fluidParticles.emitters()[0]->setVelocity(glm::vec2{ inflowSpeed, 0.0f });
+					}
+					if (ImGui::DragFloat("Fountain Rate", &fountainRate, 1.0f, 0.0f, 100000.0f)) {
+						fluidParticles.emitters()[1]->setRate(fountainRate);
+					}
+				}
+				ImGui::Text("Emitted: %d, Removed: %d", fluidParticles.emittedLastUpdate(), fluidParticles.removedLastUpdate());
+				});
+
+			gui.addWidget("Snapshot", [&]() {
+				ImGui::InputText("Path", snapshotPath, sizeof(snapshotPath));
+				try {
+					if (ImGui::Button("Save")) {
+						fluidParticles.saveSnapshot(snapshotPath);
+						snapshotStatus = "Saved step " + std::to_string(fluidParticles.stepCount());
+					}
+					ImGui::SameLine();
+					if (ImGui::Button("Load")) {
+						fluidParticles.loadSnapshot(snapshotPath);
+						letThereBeLight = true;
+						snapshotStatus = "Loaded " + std::to_string(particleInfo.numParticles) + " particles";
+					}
+				}
+				catch (const std::exception& e) {
+					snapshotStatus = e.what();
+				}
+				ImGui::TextUnformatted(snapshotStatus.c_str());
+				});
+
+			gui.addWidget("Recording", [&]() {
+				ImGui::InputText("Path", recordingPath, sizeof(recordingPath));
+				try {
+					if (!recorder && !player) {
+						if (ImGui::Button("Record")) {
+							recorder = std::make_unique<FrameRecorder>(recordingPath, recorderSettings);
+							recordingStatus.clear();
+						}
+						ImGui::SameLine();
+						if (ImGui::Button("Play")) {
+							player = std::make_unique<FramePlayer>(recordingPath);
+							recordingStatus.clear();
+						}
+					}
+					else if (ImGui::Button("Stop")) {
+						recorder.reset(); // Flushes the queued frames and closes the file
+						player.reset();
+						recordingStatus.clear();
+					}
+				}
+				catch (const std::exception& e) {
+					recordingStatus = e.what();
+				}
+				if (recorder) {
+					ImGui::Text("Recording %s: %llu frames, %llu dropped, %.2f MB", recorder->path().c_str(), static_cast<unsigned long long>(recorder->framesRecorded()),
+						static_cast<unsigned long long>(recorder->framesDropped()), recorder->bytesWritten() / (1024.0 * 1024.0));
+				}
+				if (player) {
+					ImGui::Text("Playing %s: frame %llu / %llu", player->path().c_str(), static_cast<unsigned long long>(player->position()),
+						static_cast<unsigned long long>(player->frameCount()));
+				}
+				ImGui::TextUnformatted(recordingStatus.c_str());
 				});
 
 			gui.addWidget("Interaction", [&]() {
@@ -193,20 +461,52 @@ int main(int argc, char* argv[]) {
 			mouseInteraction.radius = handRadius;
 			mouseInteraction.strengthFactor = interactionStrength;
 
-			if (letThereBeLight) {
+			if (player) {
+				// Replay one recorded frame per rendered frame
+				const RawFrame& frame = player->nextFrame();
+				playbackParticles.resize(frame.numParticles);
+				player->copyParticles(playbackParticles.data(), glm::vec4{ particleInfo.defaultColor[0], particleInfo.defaultColor[1], particleInfo.defaultColor[2], particleInfo.defaultColor[3] });
+			}
+			else if (letThereBeLight) {
+				FramePhaseTimer simPhase(timer.statistics(), FramePhase::cpuSim);
 				fluidParticles.update(); // Update the particle systems
 			}
 			else {
 				fluidParticles.arrangeParticles();
 			}
 
-			// HERE is where I would redo the DescriptorWriter calls to updateDescriptors with the updated buffer/offset size?
+			// Only frames that actually stepped the simulation are recorded, so pausing doesn't fill the recording with copies
+			if (recorder && !player && fluidParticles.stepCount() != lastRecordedStep) {
+				recorder->record(fluidParticles, fluidParticles.lastDeltaTime());
+				lastRecordedStep = fluidParticles.stepCount();
+			}
+			if (recorder && recorder->failed()) {
+				recordingStatus = recorder->error();
+				logger.print(recordingStatus);
+				recorder.reset();
+			}
+
 			// Update/fill buffers
-			globalBuffer.writeBuffer(&globalBufferObject);
-			globalParticleBuffer.writeBuffer(&particleInfo);
-			particleBuffer.writeBuffer(fluidParticles.particles());
+			{
+				PROFILE_ZONE("Upload");
+				particleRenderSystem.setGlobals(app->renderer().uploadHeap().push(globalBufferObject));
+				int drawnParticles = player ? static_cast<int>(playbackParticles.size()) : particleInfo.numParticles;
+				ensureParticleBufferCapacity(drawnParticles);
+				RenderedParticle2D* uploadParticles = player ? playbackParticles.data() : fluidParticles.particles();
+				particleBuffer->writeBuffer(uploadParticles, sizeof(RenderedParticle2D) * drawnParticles); // Only upload the live particles
+				particleRenderSystem.setParticleCount(drawnParticles);
+			}
 
 			app->renderer().renderAllSystems();
+			if (firstFrame) {
+				// Pipeline compilation dominates startup without a cache, so report which kind of start this was
+				double startupMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launchTime).count();
+				std::stringstream line;
+				line << "Startup to first frame: " << startupMilliseconds << " ms ("
+					<< (app->renderer().pipelineCache().loadedFromDisk() ? "warm" : "cold") << " pipeline cache)";
+				logger.print(line.str());
+				firstFrame = false;
+			}
 
 			app->renderer().resizeCallback(); // Check for window resize and call the window resize callback function
 
@@ -214,6 +514,7 @@ int main(int argc, char* argv[]) {
 		}
 
 		app->renderer().waitForIdle();
+		app->renderer().pipelineCache().save(); // The application is never destroyed, so the cache is saved here rather than by its destructor
 
 		logger.print("Shutting Down... Bye Bye!");
 	}
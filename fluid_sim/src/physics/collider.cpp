@@ -0,0 +1,211 @@
+#include "physics/collider.h"
+#include "physics/particle_system.h"
+#include <limits>
+#include <stdexcept>
+
+// @brief Normalizes v, or returns fallback if v has no length
+static glm::vec2 safeNormalize(glm::vec2 v, float length, glm::vec2 fallback = { 0.0f, 1.0f }) {
+	return length > 0.0f ? v / length : fallback;
+}
+
+// @brief Resolves a range of particles against the signed distance field of collider. ColliderType must be the concrete (final) collider
+//		  so the distance function is called directly and inlined into the loop. The loop body has no data-dependent branches: the
+//		  correction is scaled by masks that are zero for particles that aren't touching the collider
+template<typename ColliderType>
+static void resolveWithDistanceField(const ColliderType& collider, RenderedParticle2D* particles, int startIndex, int endIndex, float radius, float damping) {
+	// A container keeps the particles inside, which is the same as colliding with the inverted distance field
+	float side = collider.isContainer() ? -1.0f : 1.0f;
+
+	for (int i = startIndex; i < endIndex; i++) {
+		glm::vec2 normal{ 0.f, 0.f };
+		float distance = side * collider.ColliderType::signedDistance(particles[i].position, normal);
+		normal *= side;
+
+		// Negative when the particle overlaps the surface, zero otherwise
+		float penetration = glm::min(distance - radius, 0.0f);
+		particles[i].position -= penetration * normal;
+
+		// Only reflect the velocity of touching particles that are still moving into the collider
+		float normalVelocity = glm::dot(particles[i].velocity, normal);
+		float bounce = (penetration < 0.0f) & (normalVelocity < 0.0f) ? 1.0f : 0.0f;
+		particles[i].velocity -= bounce * (1.0f + damping) * normalVelocity * normal;
+	}
+}
+
+// ----------------------------------------------- BOX --------------------------------------------- //
+
+BoxCollider::BoxCollider(glm::vec2 min, glm::vec2 max, bool container) :
+	Collider(container), _min(min), _max(max) {}
+
+BoxCollider::BoxCollider(const BoundingBox& box, bool container) :
+	Collider(container), _min{ box.left, box.bottom }, _max{ box.right, box.top } {}
+
+float BoxCollider::signedDistance(glm::vec2 position, glm::vec2& normal) const {
+	glm::vec2 center = 0.5f * (_min + _max);
+	glm::vec2 halfExtent = 0.5f * (_max - _min);
+	glm::vec2 local = position - center;
+	glm::vec2 q = glm::abs(local) - halfExtent;
+	glm::vec2 sign{ local.x < 0.0f ? -1.0f : 1.0f, local.y < 0.0f ? -1.0f : 1.0f };
+
+	if (q.x > 0.0f || q.y > 0.0f) {
+		// Outside: the closest point is on an edge or a corner
+		glm::vec2 outside = glm::max(q, glm::vec2{ 0.0f, 0.0f });
+		float length = glm::sqrt(glm::dot(outside, outside));
+		normal = safeNormalize(outside * sign, length);
+		return length;
+	}
+	// Inside: the closest surface is the nearest face
+	normal = (q.x > q.y) ? glm::vec2{ sign.x, 0.0f } : glm::vec2{ 0.0f, sign.y };
+	return glm::max(q.x, q.y);
+}
+
+void BoxCollider::resolve(RenderedParticle2D* particles, int startIndex, int endIndex, float radius, float damping) const {
+	if (!_container) {
+		resolveWithDistanceField(*this, particles, startIndex, endIndex, radius, damping);
+		return;
+	}
+
+	// Containers are the common case (the bounding box), and for them each axis can be clamped independently
+	glm::vec2 low = _min + radius;
+	glm::vec2 high = _max - radius;
+	for (int i = startIndex; i < endIndex; i++) {
+		glm::vec2 position = particles[i].position;
+		glm::vec2 clamped = glm::clamp(position, low, high);
+		particles[i].position = clamped;
+		particles[i].velocity.x = (clamped.x != position.x) ? -particles[i].velocity.x * damping : particles[i].velocity.x;
+		particles[i].velocity.y = (clamped.y != position.y) ? -particles[i].velocity.y * damping : particles[i].velocity.y;
+	}
+}
+
+// ----------------------------------------------- CIRCLE --------------------------------------------- //
+
+CircleCollider::CircleCollider(glm::vec2 center, float radius, bool container) :
+	Collider(container), _center(center), _radius(radius) {}
+
+float CircleCollider::signedDistance(glm::vec2 position, glm::vec2& normal) const {
+	glm::vec2 offset = position - _center;
+	float length = glm::sqrt(glm::dot(offset, offset));
+	normal = safeNormalize(offset, length);
+	return length - _radius;
+}
+
+void CircleCollider::resolve(RenderedParticle2D* particles, int startIndex, int endIndex, float radius, float damping) const {
+	resolveWithDistanceField(*this, particles, startIndex, endIndex, radius, damping);
+}
+
+// ----------------------------------------------- CAPSULE --------------------------------------------- //
+
+CapsuleCollider::CapsuleCollider(glm::vec2 a, glm::vec2 b, float radius, bool container) :
+	Collider(container), _a(a), _b(b), _radius(radius) {}
+
+float CapsuleCollider::signedDistance(glm::vec2 position, glm::vec2& normal) const {
+	glm::vec2 segment = _b - _a;
+	float segmentLengthSquared = glm::max(glm::dot(segment, segment), std::numeric_limits<float>::min());
+	float t = glm::clamp(glm::dot(position - _a, segment) / segmentLengthSquared, 0.0f, 1.0f);
+	glm::vec2 offset = position - (_a + t * segment);
+	float length = glm::sqrt(glm::dot(offset, offset));
+	normal = safeNormalize(offset, length);
+	return length - _radius;
+}
+
+void CapsuleCollider::resolve(RenderedParticle2D* particles, int startIndex, int endIndex, float radius, float damping) const {
+	resolveWithDistanceField(*this, particles, startIndex, endIndex, radius, damping);
+}
+
+// ----------------------------------------------- POLYGON --------------------------------------------- //
+
+PolygonCollider::PolygonCollider(std::vector<glm::vec2> vertices, bool container) :
+	Collider(container), _vertices(std::move(vertices)) {
+	if (_vertices.size() < 3) {
+		throw std::runtime_error("A polygon collider needs at least 3 vertices!");
+	}
+}
+
+float PolygonCollider::signedDistance(glm::vec2 position, glm::vec2& normal) const {
+	float minSquareDst = std::numeric_limits<float>::max();
+	glm::vec2 closestOffset{ 0.f, 0.f };
+	bool inside = false;
+
+	size_t numVertices = _vertices.size();
+	for (size_t i = 0, j = numVertices - 1; i < numVertices; j = i++) {
+		// Closest point on the edge from vertex i to vertex j
+		glm::vec2 edge = _vertices[j] - _vertices[i];
+		glm::vec2 toPosition = position - _vertices[i];
+		float t = glm::clamp(glm::dot(toPosition, edge) / glm::dot(edge, edge), 0.0f, 1.0f);
+		glm::vec2 offset = toPosition - t * edge;
+		float squareDst = glm::dot(offset, offset);
+		if (squareDst < minSquareDst) {
+			minSquareDst = squareDst;
+			closestOffset = offset;
+		}
+
+		// Crossing number test. Each edge crossed by a ray towards +x flips inside/outside
+		bool crossesY = (_vertices[i].y > position.y) != (_vertices[j].y > position.y);
+		if (crossesY && position.x < _vertices[i].x + (position.y - _vertices[i].y) * edge.x / edge.y) {
+			inside = !inside;
+		}
+	}
+
+	float sign = inside ? -1.0f : 1.0f;
+	float distance = glm::sqrt(minSquareDst);
+	normal = safeNormalize(closestOffset * sign, distance);
+	return sign * distance;
+}
+
+void PolygonCollider::resolve(RenderedParticle2D* particles, int startIndex, int endIndex, float radius, float damping) const {
+	resolveWithDistanceField(*this, particles, startIndex, endIndex, radius, damping);
+}
+
+// ----------------------------------------------- SDF GRID --------------------------------------------- //
+
+SdfGridCollider::SdfGridCollider(glm::vec2 origin, float cellSize, int width, int height, std::vector<float> distances, bool container) :
+	Collider(container), _origin(origin), _cellSize(cellSize), _width(width), _height(height), _distances(std::move(distances)) {
+	if (_width < 2 || _height < 2 || _distances.size() != static_cast<size_t>(_width) * _height) {
+		throw std::runtime_error("SDF grid collider needs at least 2x2 samples and exactly width*height distances!");
+	}
+}
+
+SdfGridCollider SdfGridCollider::bake(const Collider& source, glm::vec2 min, glm::vec2 max, float cellSize) {
+	int width = static_cast<int>(glm::ceil((max.x - min.x) / cellSize)) + 1;
+	int height = static_cast<int>(glm::ceil((max.y - min.y) / cellSize)) + 1;
+
+	std::vector<float> distances(static_cast<size_t>(width) * height);
+	glm::vec2 normal{ 0.f, 0.f };
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			glm::vec2 samplePosition = min + cellSize * glm::vec2{ static_cast<float>(x), static_cast<float>(y) };
+			distances[static_cast<size_t>(y) * width + x] = source.signedDistance(samplePosition, normal);
+		}
+	}
+	return SdfGridCollider(min, cellSize, width, height, std::move(distances), source.isContainer());
+}
+
+float SdfGridCollider::signedDistance(glm::vec2 position, glm::vec2& normal) const {
+	// Continuous grid coordinates, clamped so the 2x2 interpolation footprint stays inside the grid
+	glm::vec2 gridPosition = (position - _origin) / _cellSize;
+	glm::vec2 clamped = glm::clamp(gridPosition, glm::vec2{ 0.0f, 0.0f }, glm::vec2{ _width - 1.001f, _height - 1.001f });
+	int x0 = static_cast<int>(clamped.x);
+	int y0 = static_cast<int>(clamped.y);
+	float fx = clamped.x - x0;
+	float fy = clamped.y - y0;
+
+	const float* row0 = &_distances[static_cast<size_t>(y0) * _width + x0];
+	const float* row1 = row0 + _width;
+	float d00 = row0[0], d10 = row0[1], d01 = row1[0], d11 = row1[1];
+
+	// Bilinear interpolation and its analytic gradient
+	float distance = (d00 * (1.0f - fx) + d10 * fx) * (1.0f - fy) + (d01 * (1.0f - fx) + d11 * fx) * fy;
+	glm::vec2 gradient{
+		(d10 - d00) * (1.0f - fy) + (d11 - d01) * fy,
+		(d01 - d00) * (1.0f - fx) + (d11 - d10) * fx
+	};
+	normal = safeNormalize(gradient, glm::sqrt(glm::dot(gradient, gradient)));
+
+	// Outside the grid, add the distance to the grid border so the field keeps growing
+	glm::vec2 outside = (gridPosition - clamped) * _cellSize;
+	return distance + glm::sqrt(glm::dot(outside, outside));
+}
+
+void SdfGridCollider::resolve(RenderedParticle2D* particles, int startIndex, int endIndex, float radius, float damping) const {
+	resolveWithDistanceField(*this, particles, startIndex, endIndex, radius, damping);
+}
@@ -0,0 +1,68 @@
+#include "physics/integrator.h"
+#include "physics/particle_system.h"
+
+// ----------------------------------------------- HEUN --------------------------------------------- //
+
+void HeunIntegrator::step(ParticleSystem2D& system, float deltaTime) {
+	int numParticles = system.particleInfo().numParticles;
+	RenderedParticle2D* particles = system.particles();
+	glm::vec2* acceleration = system.accelerations();
+	float halfDeltaTime = 0.5f * deltaTime;
+
+	if (_predicted.size() < static_cast<size_t>(numParticles)) {
+		_predicted.resize(numParticles);
+		_predictedAcceleration.resize(numParticles);
+	}
+
+	// Finds density and acceleration at the current state. Now we have l1=acceleration and k1=particles[i].velocity
+	system.computeAccelerations(particles, acceleration);
+
+	// Find k2 by taking an euler step
+	for (int i = 0; i < numParticles; i++) {
+		_predicted[i].velocity = particles[i].velocity + deltaTime * acceleration[i];
+		_predicted[i].position = particles[i].position + deltaTime * particles[i].velocity;
+	}
+
+	// This finds l2. The spatial lookup has to be rebuilt for the predicted positions, which doubles the neighbor work
+	system.computeAccelerations(_predicted.data(), _predictedAcceleration.data());
+
+	// Then combine it all to get the next position
+	for (int i = 0; i < numParticles; i++) {
+		particles[i].velocity += halfDeltaTime * (acceleration[i] + _predictedAcceleration[i]);
+		particles[i].position += halfDeltaTime * (particles[i].velocity + _predicted[i].velocity);
+	}
+}
+
+size_t HeunIntegrator::bytesPerParticle() const {
+	return sizeof(Particle2D) + sizeof(glm::vec2);
+}
+
+// ----------------------------------------------- LEAPFROG --------------------------------------------- //
+
+void LeapfrogIntegrator::step(ParticleSystem2D& system, float deltaTime) {
+	int numParticles = system.particleInfo().numParticles;
+	RenderedParticle2D* particles = system.particles();
+	glm::vec2* acceleration = system.accelerations();
+	float halfDeltaTime = 0.5f * deltaTime;
+
+	// The first step (or the first step after a reset) has no acceleration to reuse, so evaluate it once here.
+	// Particles added or removed by emitters and sinks keep their accelerations consistent, so they don't need a reset
+	if (!_accelerationValid) {
+		system.computeAccelerations(particles, acceleration);
+	}
+
+	// Kick by half a step, then drift a full step with the half-step velocity
+	for (int i = 0; i < numParticles; i++) {
+		particles[i].velocity += halfDeltaTime * acceleration[i];
+		particles[i].position += deltaTime * particles[i].velocity;
+	}
+
+	// The only force evaluation of the step. Its result is also used for the first kick of the next step
+	system.computeAccelerations(particles, acceleration);
+	_accelerationValid = true;
+
+	// Kick the remaining half step
+	for (int i = 0; i < numParticles; i++) {
+		particles[i].velocity += halfDeltaTime * acceleration[i];
+	}
+}
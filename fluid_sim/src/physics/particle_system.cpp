@@ -1,77 +1,112 @@
 #include "physics/particle_system.h"
-#include <random>
+#include "physics/snapshot.h"
+#include "utility/profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 
 static const glm::vec2 down{ 0.0f, -0.1f };
 static const double pi = 3.14159265358979323846;
 static bool usePredictedPositions = false;
-
-static long double norm(glm::vec2 v) {
-	return glm::sqrt(v.x * v.x + v.y * v.y);
-}
+static const int defaultThreadCount = 16;
+static const int minimumCapacity = 1024; // Smallest allocation of the particle arrays
+static const int defaultParticleLimit = 1 << 20;
 
 ParticleSystem2D::ParticleSystem2D(
 	GlobalParticleInfo& particleInfo, 
 	GlobalPhysicsInfo& physicsInfo,
 	BoundingBox& box,
-	InputManager& inputManager,
+	InputManager* inputManager,
 	Hand* hand
 	) :
+	_capacity(0),
+	_bbox(box),
 	_globalParticleInfo(particleInfo),
 	_globalPhysics(physicsInfo),
-	_bbox(box),
 	_inputManager(inputManager),
 	_interactionHand(hand),
 	_simulationPaused(false),
-	_doOneFrame(false) {
-
-	_particles = new RenderedParticle2D[MAX_PARTICLES];
-	_densities = new float[MAX_PARTICLES];
-
-	_acceleration = new glm::vec2[MAX_PARTICLES];
-	_particleIndices = new uint32_t[MAX_PARTICLES];
-	_spatialLookup = new uint32_t[MAX_PARTICLES];
-	_startIndices = new uint32_t[MAX_PARTICLES];
-
-	_particles2 = new Particle2D[MAX_PARTICLES];
-	// Uncomment for RK4 (slower and didn't have much improvement in terms of stability...)
-	//_particles3 = new Particle2D[MAX_PARTICLES];
-	//_particles4 = new Particle2D[MAX_PARTICLES];
-
-	// Initialize all entries to 0 in case we add more
-	for (int i = 0; i < MAX_PARTICLES; i++) {
-		_densities[i] = 0.0f;
-		_particles2[i].position = { 0.f, 0.f }; _particles2[i].velocity = { 0.f, 0.f };
-		// Uncomment for RK4 (slower and didn't have much improvement in terms of stability...)
-		//_particles3[i].position = { 0.f, 0.f }; _particles3[i].velocity = { 0.f, 0.f };
-		//_particles4[i].position = { 0.f, 0.f }; _particles4[i].velocity = { 0.f, 0.f };
-
-		_particleIndices[i] = i;
-		_spatialLookup[i] = 0;
-		_startIndices[i] = INT_MAX;
-	}
+	_doOneFrame(false),
+	_lastUpdateMilliseconds(0.0),
+	_lastDeltaTime(0.0f),
+	_stepCount(0),
+	_lastStateHash(0),
+	_integratorType(IntegratorType::leapfrog),
+	_lastParticleCount(0),
+	_particleLimit(defaultParticleLimit),
+	_emittedLastUpdate(0),
+	_removedLastUpdate(0),
+	_maxSmoothingScale(1.0f),
+	_activeParticles(0),
+	_cellSize(physicsInfo.densitySmoothingRadius),
+	_numThreads(defaultThreadCount) {
+
+	setIntegrator(_integratorType);
+	ensureCapacity(_globalParticleInfo.numParticles);
 	arrangeParticles();
 	assignInputEvents();
 }
 
-ParticleSystem2D::~ParticleSystem2D() {
-	delete[] _particles;
-	delete[] _densities;
+ParticleSystem2D::~ParticleSystem2D() {}
+
+void ParticleSystem2D::ensureCapacity(int numParticles) {
+	if (numParticles <= _capacity) return;
+
+	// Grow geometrically so that adding particles one at a time doesn't reallocate every frame
+	int newCapacity = std::max({ numParticles, 2 * _capacity, minimumCapacity });
+
+	_particles.resize(newCapacity);
+	_densities.resize(newCapacity, 0.0f);
+	_acceleration.resize(newCapacity, glm::vec2{ 0.f, 0.f });
+	_masses.resize(newCapacity, 1.0f);
+	_smoothingScales.resize(newCapacity, 1.0f);
+	_adaptFlags.resize(newCapacity, 0);
+	_sleeping.resize(newCapacity, 0);
+	_calmUpdates.resize(newCapacity, 0);
+	_sleepDensities.resize(newCapacity, 0.0f);
+	_cellActive.resize(newCapacity, 0);
+	_particleIndices.resize(newCapacity, 0);
+	_spatialLookup.resize(newCapacity, 0);
+	_startIndices.resize(newCapacity, INT_MAX);
+	_collisionPositionCorrection.resize(newCapacity, glm::vec2{ 0.f, 0.f });
+	_collisionVelocityCorrection.resize(newCapacity, glm::vec2{ 0.f, 0.f });
+
+	_capacity = newCapacity;
+}
 
-	delete[] _acceleration;
-	delete[] _particleIndices;
-	delete[] _spatialLookup;
-	delete[] _startIndices;
+ParticleMemoryFootprint ParticleSystem2D::memoryFootprint() const {
+	size_t bytesPerParticle = sizeof(RenderedParticle2D) // particles
+		+ sizeof(float) // densities
+		+ 2 * sizeof(float) + sizeof(uint8_t) // masses, smoothing scales and adaptation flags
+		+ 2 * sizeof(uint8_t) + sizeof(uint16_t) + sizeof(float) // sleep flags, cell activity, calm counters and sleep densities
+		+ 3 * sizeof(glm::vec2) // accelerations and collision corrections
+		+ 3 * sizeof(uint32_t) // spatial hash
+		+ _integrator->bytesPerParticle();
+
+	return ParticleMemoryFootprint{
+		.bytesPerParticle = bytesPerParticle,
+		.liveBytes = bytesPerParticle * _globalParticleInfo.numParticles,
+		.capacityBytes = bytesPerParticle * _capacity
+	};
+}
 
-	delete[] _particles2;
-	// Uncomment for RK4 (slower and didn't have much improvement in terms of stability...)
-	//delete[] _particles3;
-	//delete[] _particles4;
+void ParticleSystem2D::setIntegrator(IntegratorType type) {
+	_integratorType = type;
+	switch (type) {
+	case IntegratorType::heun:
+		_integrator = std::make_unique<HeunIntegrator>();
+		break;
+	case IntegratorType::leapfrog:
+		_integrator = std::make_unique<LeapfrogIntegrator>();
+		break;
+	}
 }
 
 // @brief Returns an integer vector containing the indices of the grid cell the position corresponds to
-static glm::ivec2 getGridCell(glm::vec2 position, int cellSize) {
-	int cellX = static_cast<int>(position.x / cellSize);
-	int cellY = static_cast<int>(position.y / cellSize);
+static glm::ivec2 getGridCell(glm::vec2 position, float cellSize) {
+	// Cell sizes are fractions of a unit, so they must not be truncated to an int. Flooring keeps cells on either side of an axis the same size
+	int cellX = static_cast<int>(glm::floor(position.x / cellSize));
+	int cellY = static_cast<int>(glm::floor(position.y / cellSize));
 	//std::cout << "Grid Cell Coordinates: (" << cellX << ", " << cellY << ")" << std::endl;
 	return glm::vec2{ cellX, cellY };
 }
@@ -85,7 +120,15 @@ static uint32_t hashGridCell(glm::ivec2 gridCell, uint32_t hashSize) {
 	return (static_cast<uint32_t>(gridCell.x) * p1 + static_cast<uint32_t>(gridCell.y) * p2) % hashSize;
 }
 
+static const std::vector<glm::ivec2> gridCellOffsets {
+	{1, 1}, {1, 0}, {1, -1},
+	{0, 1}, {0, -1}, {0, 0},
+	{-1, 0}, {-1, 1}, {-1, -1}
+};
+
 void ParticleSystem2D::arrangeParticles() {
+	ensureCapacity(_globalParticleInfo.numParticles);
+
 	float spacing = _globalParticleInfo.radius + _globalParticleInfo.spacing;
 	glm::vec2 offset = glm::vec2();
 
@@ -109,168 +152,333 @@ void ParticleSystem2D::arrangeParticles() {
 		// Set a random starting velocity
 		// _particles[i].velocity = glm::vec2{ distribution(generator), distribution(generator) };
 		_particles[i].velocity = glm::vec2{ 0.f, 0.f };
+		_masses[i] = 1.0f;
+		_smoothingScales[i] = 1.0f;
 	}
+	_maxSmoothingScale = 1.0f;
+	wakeAllParticles();
+
+	// Any acceleration carried over by the integrator belongs to the old arrangement
+	_integrator->reset();
+	_lastParticleCount = _globalParticleInfo.numParticles;
 }
 
-static const int numThreads = 16;
+Emitter& ParticleSystem2D::addEmitter(std::unique_ptr<Emitter> emitter) {
+	_emitters.push_back(std::move(emitter));
+	return *_emitters.back();
+}
 
-void ParticleSystem2D::update() {
-	if (_simulationPaused && !_doOneFrame) {
-		return;
+Sink& ParticleSystem2D::addSink(std::unique_ptr<Sink> sink) {
+	_sinks.push_back(std::move(sink));
+	return *_sinks.back();
+}
+
+int ParticleSystem2D::spawnParticles(const Particle2D* particles, int count) {
+	int start = _globalParticleInfo.numParticles;
+	count = std::min(count, std::max(_particleLimit - start, 0));
+	if (count == 0) return 0;
+	ensureCapacity(start + count);
+
+	glm::vec4 color{ _globalParticleInfo.defaultColor[0], _globalParticleInfo.defaultColor[1], _globalParticleInfo.defaultColor[2], _globalParticleInfo.defaultColor[3] };
+	for (int i = 0; i < count; i++) {
+		_particles[start + i].position = particles[i].position;
+		_particles[start + i].velocity = particles[i].velocity;
+		_particles[start + i].color = color;
+		// New particles have no force history. A zero acceleration only affects their first half-kick, and lets the
+		// integrator keep the accelerations of every other particle instead of re-evaluating all of them
+		_acceleration[start + i] = glm::vec2{ 0.f, 0.f };
+		_masses[start + i] = 1.0f;
+		_smoothingScales[start + i] = 1.0f;
+		_sleeping[start + i] = 0;
+		_calmUpdates[start + i] = 0;
+		_sleepDensities[start + i] = 0.0f;
 	}
 
-	static Timer& timer = Timer::getTimer();
-	float subDeltaTime = timer.frameTime() / _globalPhysics.nSubsteps;
-	//float predictionStep = 1.f / 120.f; // Used to gain some stability with the position-prediction code. I should refine this later on.
+	_globalParticleInfo.numParticles += count;
+	_lastParticleCount = _globalParticleInfo.numParticles;
+	return count;
+}
 
-	// Parallel batching setup
-	std::vector<int> batchSizes;
-	batchSizes.reserve(numThreads);
-	int batchSize = _globalParticleInfo.numParticles / numThreads; // Divides the work to be done into equal batches
-	// In case numThreads doesn't divide numParticles evenly. If numThreads divides numParticles, then this should be equal to batchSize
-	int oddBatchOut = _globalParticleInfo.numParticles - (numThreads - 1) * batchSize;
+void ParticleSystem2D::moveParticle(int from, int to) {
+	_particles[to] = _particles[from];
+	_acceleration[to] = _acceleration[from];
+	_masses[to] = _masses[from];
+	_smoothingScales[to] = _smoothingScales[from];
+	// Sleeping particles aren't re-evaluated, so their density has to travel with them
+	_densities[to] = _densities[from];
+	_sleeping[to] = _sleeping[from];
+	_calmUpdates[to] = _calmUpdates[from];
+	_sleepDensities[to] = _sleepDensities[from];
+}
 
-	// Fill batchSizes 
-	for (int i = 0; i < numThreads-1; i++) {
-		batchSizes.push_back(batchSize);
+int ParticleSystem2D::removeAbsorbedParticles() {
+	int numParticles = _globalParticleInfo.numParticles;
+	int removed = 0;
+
+	int i = 0;
+	while (i < numParticles) {
+		bool absorbed = false;
+		for (auto& sink : _sinks) {
+			if (sink->enabled() && sink->absorbs(_particles[i].position)) {
+				absorbed = true;
+				break;
+			}
+		}
+
+		if (absorbed) {
+			// Swap in the last live particle and test the same slot again, since the moved particle hasn't been checked yet
+			numParticles--;
+			moveParticle(numParticles, i);
+			removed++;
+		}
+		else {
+			i++;
+		}
 	}
-	batchSizes.push_back(oddBatchOut);
 
-	glm::vec2* l2 = new glm::vec2[_globalParticleInfo.numParticles];
-	// Uncomment for RK4 (slower and didn't have much improvement in terms of stability...)
-	//glm::vec2* l3 = new glm::vec2[_globalParticleInfo.numParticles];
-	//glm::vec2* l4 = new glm::vec2[_globalParticleInfo.numParticles];
+	_globalParticleInfo.numParticles = numParticles;
+	_lastParticleCount = numParticles;
+	return removed;
+}
 
-	for (int i = 0; i < _globalPhysics.nSubsteps; i++) {
+void ParticleSystem2D::updateSourcesAndSinks(float deltaTime) {
+	// Sinks first, so particles emitted inside a sink still live for one step
+	_removedLastUpdate = _sinks.empty() ? 0 : removeAbsorbedParticles();
 
-		float halfDeltaTime = 0.5f * subDeltaTime;
+	_spawned.clear();
+	for (auto& emitter : _emitters) {
+		emitter->emit(deltaTime, _spawned);
+	}
+	_emittedLastUpdate = spawnParticles(_spawned.data(), static_cast<int>(_spawned.size()));
+}
 
-		// For RK4, the position and velocity of _particles[i] acts as the INITIAL values until the end
 
-		// Update the spatial lookup arrays for use in calculating densities and forces
-		updateSpatialLookup<RenderedParticle2D>(_particles);
+void ParticleSystem2D::update() {
+	static Timer& timer = Timer::getTimer();
+	update(_deterministic.enabled ? _deterministic.fixedDeltaTime : timer.frameTime());
+}
 
-		// Finds density at current r_i
-		calculateParticleDensitiesParallel<RenderedParticle2D>(batchSizes, _particles);
-		// Wait for futures to get results
-		for (int i = 0; i < numThreads; i++) {
-			_futures[i].get();
-		}
-		_futures.clear();
-		// Does an euler step of dv/dt to get velocity at the (i+1)th step
-		getAccelerationParallel<RenderedParticle2D>(batchSizes, _acceleration, _particles);
-		for (int i = 0; i < numThreads; i++) {
-			_futures[i].get();
-		}
-		_futures.clear();
-		// Now we have l1=_acceleration and k1=_particles[i].velocity
-
-		// Find k2 and l2
-		for (int i = 0; i < _globalParticleInfo.numParticles; i++) {
-			// Uncomment for RK4 (slower and didn't have much improvement in terms of stability...)
-			//_particles2[i].position = _particles[i].position + _particles[i].velocity * halfDeltaTime;
-			//_particles2[i].velocity = _particles[i].velocity + halfDeltaTime * _acceleration[i]; // This is k2
-			_particles2[i].velocity = _particles[i].velocity + subDeltaTime * _acceleration[i]; // This is k2
-			_particles2[i].position = _particles[i].position + subDeltaTime * _particles[i].velocity;
-		}
-		updateSpatialLookup<Particle2D>(_particles2);
-		calculateParticleDensitiesParallel<Particle2D>(batchSizes, _particles2);
-		for (int i = 0; i < numThreads; i++) {
-			_futures[i].get();
-		}
-		_futures.clear();
-		getAccelerationParallel<Particle2D>(batchSizes, l2, _particles2); // This finds l2
-		for (int i = 0; i < numThreads; i++) {
-			_futures[i].get();
-		}
-		_futures.clear();
-
-		// Uncomment for RK4 (slower and didn't have much improvement in terms of stability...)
-		//// Find k3 and l3
-		//for (int i = 0; i < _globalParticleInfo.numParticles; i++) {
-		//	_particles3[i].velocity = _particles[i].velocity + halfDeltaTime * l2[i]; // This is k3
-		//	_particles3[i].position = _particles[i].position + _particles2[i].velocity * halfDeltaTime;
-		//}
-		//updateSpatialLookup<Particle2D>(_particles3);
-		//calculateParticleDensitiesParallel<Particle2D>(batchSizes, _particles3);
-		//for (int i = 0; i < numThreads; i++) {
-		//	_futures[i].get();
-		//}
-		//_futures.clear();
-		//getAccelerationParallel<Particle2D>(batchSizes, l3, _particles3);
-		//for (int i = 0; i < numThreads; i++) {
-		//	_futures[i].get();
-		//}
-		//_futures.clear();
-
-		//// Find k4 and l4
-		//for (int i = 0; i < _globalParticleInfo.numParticles; i++) {
-		//	_particles4[i].velocity = _particles[i].velocity + 2.f * halfDeltaTime * l3[i]; // This is k4
-		//	_particles4[i].position = _particles[i].position + _particles3[i].velocity * 2.f * halfDeltaTime;
-		//}
-		// updateSpatialLookup<Particle2D>(_particles4);
-		//calculateParticleDensitiesParallel<Particle2D>(batchSizes, _particles4);
-		//for (int i = 0; i < numThreads; i++) {
-		//	_futures[i].get();
-		//}
-		//_futures.clear();
-		//getAccelerationParallel<Particle2D>(batchSizes, l4, _particles4);
-		//for (int i = 0; i < numThreads; i++) {
-		//	_futures[i].get();
-		//}
-		//_futures.clear();
-
-		// Then combine it all to get the next position
-		for (int i = 0; i < _globalParticleInfo.numParticles; i++) {
-			// Uncomment for RK4 (slower and didn't have much improvement in terms of stability...)
-			//_particles[i].velocity += subDeltaTime / 6.f * (_acceleration[i] + 2.f * l2[i] + 2.f * l3[i] + l4[i]);
-			//_particles[i].position += subDeltaTime / 6.f * (_particles[i].velocity + 2.f * _particles2[i].velocity + 2.f * _particles3[i].velocity + _particles4[i].velocity);
-			_particles[i].velocity += halfDeltaTime * (_acceleration[i] + l2[i]);
-			_particles[i].position += halfDeltaTime * (_particles[i].velocity + _particles2[i].velocity);
+void ParticleSystem2D::update(float deltaTime) {
+	if (_simulationPaused && !_doOneFrame) {
+		return;
+	}
+	PROFILE_ZONE("Physics Update");
+
+	float subDeltaTime = deltaTime / _globalPhysics.nSubsteps;
+
+	auto updateStart = std::chrono::steady_clock::now();
+
+	// The count was changed from outside the system (e.g. the GUI), so the new particles have no valid integrator state
+	if (_globalParticleInfo.numParticles != _lastParticleCount) {
+		ensureCapacity(_globalParticleInfo.numParticles);
+		_integrator->reset();
+		wakeAllParticles();
+	}
+
+	{
+		PROFILE_ZONE("Sources and Sinks");
+		updateSourcesAndSinks(deltaTime);
+	}
+	updateBatchSizes();
+
+	for (int i = 0; i < _globalPhysics.nSubsteps; i++) {
+		// The integrator evaluates the forces as many times as its scheme needs and advances the particles
+		{
+			PROFILE_ZONE("Integrate");
+			_integrator->step(*this, subDeltaTime);
 		}
 
 		// Resolve collisions between particles
-		// resolveParticleCollisions();
+		if (_globalPhysics.particleCollisions) {
+			resolveParticleCollisions();
+		}
 
 		// Resolve collisions with the walls of the bounding box
 		resolveBoundaryCollisions();
 	}
+
+	if (_adaptivity.enabled && _adaptivity.interval > 0 && (_stepCount + 1) % _adaptivity.interval == 0) {
+		adaptParticleSizes();
+	}
+	if (_sleep.enabled) {
+		updateSleepStates();
+	}
 	frameDone();
 
-	delete[] l2;
-	// Uncomment for RK4 (slower and didn't have much improvement in terms of stability...)
-	//delete[] l3;
-	//delete[] l4;
+	_lastParticleCount = _globalParticleInfo.numParticles;
+	_stepCount++;
+	_lastDeltaTime = deltaTime;
+	_lastStateHash = _deterministic.enabled ? stateHash() : 0;
+	_lastUpdateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - updateStart).count();
 }
 
-void ParticleSystem2D::resolveBoundaryCollisions() {
+void ParticleSystem2D::updateBatchSizes() {
+	_batchSizes.clear();
+	_batchSizes.reserve(_numThreads);
+	int batchSize = _globalParticleInfo.numParticles / _numThreads; // Divides the work to be done into equal batches
+	// In case _numThreads doesn't divide numParticles evenly. If _numThreads divides numParticles, then this should be equal to batchSize
+	int oddBatchOut = _globalParticleInfo.numParticles - (_numThreads - 1) * batchSize;
+
+	// Fill batchSizes 
+	for (int i = 0; i < _numThreads - 1; i++) {
+		_batchSizes.push_back(batchSize);
+	}
+	_batchSizes.push_back(oddBatchOut);
+}
+
+void ParticleSystem2D::runBatchesParallel(const char* zoneName, const std::function<void(int, int)>& job) {
+	int start = 0;
+	int end = 0;
+	for (int batchSize : _batchSizes) {
+		start = end;
+		end = start + batchSize;
+		_futures.push_back(std::async(std::launch::async, [&job, zoneName](int startIndex, int endIndex) {
+			PROFILE_ZONE(zoneName);
+			job(startIndex, endIndex);
+		}, start, end));
+	}
+	// Wait for futures to get results
+	for (auto& future : _futures) {
+		future.get();
+	}
+	_futures.clear();
+}
+
+template<typename ParticleType>
+void ParticleSystem2D::computeAccelerations(ParticleType* particles, glm::vec2* outputAccel) {
+	// Update the spatial lookup arrays for use in calculating densities and forces
+	{
+		PROFILE_ZONE("Spatial Lookup");
+		updateSpatialLookup<ParticleType>(particles);
+	}
+
+	// The pressure force needs every density, so the density pass has to finish before the acceleration pass starts
+	{
+		PROFILE_ZONE("Densities");
+		calculateParticleDensitiesParallel<ParticleType>(particles);
+	}
+	{
+		PROFILE_ZONE("Accelerations");
+		getAccelerationParallel<ParticleType>(outputAccel, particles);
+	}
+}
+
+double ParticleSystem2D::mechanicalEnergy() const {
+	glm::vec2 gravityAcceleration = _globalPhysics.gravity * down;
+	double energy = 0.0;
 	for (int i = 0; i < _globalParticleInfo.numParticles; i++) {
-		if (_particles[i].position.y < (_bbox.bottom + _globalParticleInfo.radius)) {
-			_particles[i].position.y = _bbox.bottom + _globalParticleInfo.radius;
-			_particles[i].velocity.y = -_particles[i].velocity.y * _globalPhysics.boundaryDampingFactor;
-		}
-		else if (_particles[i].position.y > (_bbox.top - _globalParticleInfo.radius)) {
-			_particles[i].position.y = _bbox.top - _globalParticleInfo.radius;
-			_particles[i].velocity.y = -_particles[i].velocity.y * _globalPhysics.boundaryDampingFactor;
-		}
-		if (_particles[i].position.x > (_bbox.right - _globalParticleInfo.radius)) {
-			_particles[i].position.x = _bbox.right - _globalParticleInfo.radius;
-			_particles[i].velocity.x = -_particles[i].velocity.x * _globalPhysics.boundaryDampingFactor;
-		}
-		else if (_particles[i].position.x < (_bbox.left + _globalParticleInfo.radius)) {
-			_particles[i].position.x = _bbox.left + _globalParticleInfo.radius;
-			_particles[i].velocity.x = -_particles[i].velocity.x * _globalPhysics.boundaryDampingFactor;
+		energy += _masses[i] * (0.5 * glm::dot(_particles[i].velocity, _particles[i].velocity) - glm::dot(gravityAcceleration, _particles[i].position));
+	}
+	return energy;
+}
+
+uint64_t ParticleSystem2D::stateHash() const {
+	const uint64_t offsetBasis = 14695981039346656037ull;
+	const uint64_t prime = 1099511628211ull;
+
+	uint64_t hash = offsetBasis;
+	auto hashBytes = [&hash, prime](const void* data, size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ bytes[i]) * prime;
 		}
+	};
+
+	int numParticles = _globalParticleInfo.numParticles;
+	hashBytes(&numParticles, sizeof(numParticles));
+	for (int i = 0; i < numParticles; i++) {
+		hashBytes(&_particles[i].position, sizeof(glm::vec2));
+		hashBytes(&_particles[i].velocity, sizeof(glm::vec2));
+		hashBytes(&_masses[i], sizeof(float));
 	}
+	return hash;
+}
+
+void ParticleSystem2D::saveSnapshot(const std::string& path) const {
+	PROFILE_ZONE("Save Snapshot");
+	SnapshotHeader header;
+	std::memset(&header, 0, sizeof(header));
+	header.numParticles = _globalParticleInfo.numParticles;
+	header.integratorType = static_cast<uint32_t>(_integratorType);
+	header.accelerationsValid = _integrator->carriesAccelerations() ? 1 : 0;
+	header.stepCount = _stepCount;
+	header.stateHash = stateHash();
+	header.particleInfo = _globalParticleInfo;
+	header.physicsInfo = _globalPhysics;
+	header.box = _bbox;
+	header.deterministic = _deterministic;
+	header.adaptivity = _adaptivity;
+	Snapshot::write(path, header, _particles.data(), _acceleration.data(), _masses.data(), _smoothingScales.data());
+}
+
+void ParticleSystem2D::loadSnapshot(const std::string& path) {
+	loadSnapshot(Snapshot(path));
+}
+
+void ParticleSystem2D::loadSnapshot(const Snapshot& snapshot) {
+	PROFILE_ZONE("Load Snapshot");
+	const SnapshotHeader& header = snapshot.header();
+	ensureCapacity(header.numParticles);
+	std::memcpy(_particles.data(), snapshot.particles(), static_cast<size_t>(header.numParticles) * sizeof(RenderedParticle2D));
+	std::memcpy(_acceleration.data(), snapshot.accelerations(), static_cast<size_t>(header.numParticles) * sizeof(glm::vec2));
+	if (snapshot.hasMasses()) {
+		std::memcpy(_masses.data(), snapshot.masses(), static_cast<size_t>(header.numParticles) * sizeof(float));
+		std::memcpy(_smoothingScales.data(), snapshot.smoothingScales(), static_cast<size_t>(header.numParticles) * sizeof(float));
+		_adaptivity = header.adaptivity;
+	}
+	else {
+		std::fill_n(_masses.begin(), header.numParticles, 1.0f);
+		std::fill_n(_smoothingScales.begin(), header.numParticles, 1.0f);
+		_adaptivity = AdaptivitySettings{};
+	}
+
+	_globalParticleInfo = header.particleInfo;
+	_globalParticleInfo.numParticles = header.numParticles;
+	_globalPhysics = header.physicsInfo;
+	_bbox = header.box;
+	_deterministic = header.deterministic;
+	_stepCount = header.stepCount;
+	_lastStateHash = header.stateHash;
+	updateMaxSmoothingScale();
+	wakeAllParticles();
+	setIntegrator(static_cast<IntegratorType>(header.integratorType));
+
+	// With the accelerations the integrator carried, the next step is bit-identical to the one the saved run took
+	_integrator->reset();
+	if (header.accelerationsValid) {
+		_integrator->restoreAccelerations();
+	}
+	_lastParticleCount = header.numParticles;
+}
+
+void ParticleSystem2D::resolveBoundaryCollisions() {
+	PROFILE_ZONE("Boundary Collisions");
+	// The bounding box follows the window, so its collider is rebuilt every call
+	BoxCollider boundingBox(_bbox, true);
+	float radius = _globalParticleInfo.radius;
+	float damping = _globalPhysics.boundaryDampingFactor;
+
+	// Each batch runs every collider over its own range of particles. The bounding box goes last so no obstacle can push particles out of it
+	runBatchesParallel("Boundary Batch", [this, &boundingBox, radius, damping](int startIndex, int endIndex) {
+		for (auto& collider : _colliders) {
+			collider->resolve(_particles.data(), startIndex, endIndex, radius, damping);
+		}
+		boundingBox.resolve(_particles.data(), startIndex, endIndex, radius, damping);
+	});
+}
+
+Collider& ParticleSystem2D::addCollider(std::unique_ptr<Collider> collider) {
+	_colliders.push_back(std::move(collider));
+	return *_colliders.back();
 }
 
 template<typename ParticleType>
 float ParticleSystem2D::calculateDensity(uint32_t particleIndex, ParticleType* particles) {
 	float density = 0.0f;
 	// Use the locations of each particle to calculate the density at position, with the smoothing function lessening the impact of particles further away
-	loopThroughNearbyPoints(particles[particleIndex].position, particles, [&](glm::vec2 dist, int particleIndex) {
+	loopThroughNearbyPoints(particles[particleIndex].position, particles, [&](glm::vec2 dist, uint32_t index) {
 		float squareDst = glm::dot(dist, dist);
-		density += SmoothingKernels2D::smooth(squareDst, _globalPhysics.densitySmoothingRadius);
+		density += _masses[index] * SmoothingKernels2D::smooth(squareDst, pairSmoothingLength(particleIndex, index));
 	});
 	if (density == 0.0f) {
 		std::cout << "ERROR: density is 0 for particleIndex: " << particleIndex << std::endl;
@@ -279,19 +487,15 @@ float ParticleSystem2D::calculateDensity(uint32_t particleIndex, ParticleType* p
 }
 
 template<typename ParticleType>
-void ParticleSystem2D::calculateParticleDensitiesParallel(std::vector<int> batchSizes, ParticleType* particles) {
+void ParticleSystem2D::calculateParticleDensitiesParallel(ParticleType* particles) {
 	// We want to calculate the density at each particle location all at once.
-	int start = 0;
-	int end = 0;
-	for (int i = 0; i < numThreads; i++) {
-		start = end;
-		end = start + batchSizes[i];
-		_futures.push_back(std::async(std::launch::async, [this, particles](int startIndex, int endIndex) {
-			for (int i = startIndex; i < endIndex; i++) {
-				_densities[i] = calculateDensity(i, particles); // for k1
-			}
-		}, start, end));
-	}
+	runBatchesParallel("Density Batch", [this, particles](int startIndex, int endIndex) {
+		for (int i = startIndex; i < endIndex; i++) {
+			// Sleeping particles keep the density they fell asleep with
+			if (_sleeping[i]) continue;
+			_densities[i] = calculateDensity(i, particles);
+		}
+	});
 }
 
 template<typename ParticleType>
@@ -303,7 +507,7 @@ glm::vec2 ParticleSystem2D::getAcceleration(uint32_t particleIndex, ParticleType
 	glm::vec2 pressureAcceleration{ 0.f, 0.f };
 
 	// Input actions modify gravity
-	if (_interactionHand->isInteracting()) {
+	if (_interactionHand && _interactionHand->isInteracting()) {
 		float interactionStrength = _interactionHand->action() == HandAction::pulling ? _interactionHand->strengthFactor : -_interactionHand->strengthFactor;
 		// Hand is interacting, so find the vector from the hand to the particle and find its squared distance
 		glm::vec2 particleToHand = _interactionHand->position() - particles[particleIndex].position;
@@ -320,33 +524,234 @@ glm::vec2 ParticleSystem2D::getAcceleration(uint32_t particleIndex, ParticleType
 	}
 
 	// Get force due to pressure and convert it to acceleration by dividing by density
-	pressureAcceleration = calculatePressureForce(particleIndex, particles, _densities) / _densities[particleIndex];
+	pressureAcceleration = calculatePressureForce(particleIndex, particles, _densities.data()) / _densities[particleIndex];
 	glm::vec2 gravityAcceleration = _globalPhysics.gravity * down;
 	return handAcceleration + pressureAcceleration + gravityAcceleration;
 }
 
 template<typename ParticleType>
-void ParticleSystem2D::getAccelerationParallel(std::vector<int> batchSizes, glm::vec2* outputAccel, ParticleType* particles) {
-	int start = 0;
-	int end = 0;
-	for (int i = 0; i < numThreads; i++) {
-		start = end;
-		end = start + batchSizes[i];
-		_futures.push_back(std::async(std::launch::async, [this, particles, outputAccel](int startIndex, int endIndex) {
-			for (int i = startIndex; i < endIndex; i++) {
-				// getAcceleration applies gravity, interaction force, and pressure force at once
-				outputAccel[i] = getAcceleration(i, particles); // This is dv/dt (and k1)
+void ParticleSystem2D::getAccelerationParallel(glm::vec2* outputAccel, ParticleType* particles) {
+	runBatchesParallel("Acceleration Batch", [this, particles, outputAccel](int startIndex, int endIndex) {
+		for (int i = startIndex; i < endIndex; i++) {
+			// getAcceleration applies gravity, interaction force, and pressure force at once. Sleeping particles feel nothing, so they stay put
+			outputAccel[i] = _sleeping[i] ? glm::vec2{ 0.f, 0.f } : getAcceleration(i, particles); // This is dv/dt
+		}
+	});
+}
+
+// @brief SplitMix64 finalizer, spreads every input bit over the whole output
+static uint64_t mixBits(uint64_t x) {
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+// @brief Random unit direction from particle a towards particle b, for particles exactly on top of each other. It is a pure function of
+//		  the seed, the step and the pair, so it doesn't depend on which thread evaluates it, and the direction from b to a is exactly
+//		  opposite, so the pair's pressure forces still cancel
+static glm::vec2 getRandomDirection(uint64_t seed, uint64_t step, uint32_t a, uint32_t b) {
+	uint64_t pair = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+	uint64_t bits = mixBits(mixBits(seed ^ mixBits(step)) ^ pair);
+	float angle = static_cast<float>((bits >> 40) * (2.0 * pi / static_cast<double>(1ull << 24)));
+	glm::vec2 direction{ glm::cos(angle), glm::sin(angle) };
+	return a < b ? direction : -direction;
+}
+
+int ParticleSystem2D::coarseParticleCount() const {
+	int count = 0;
+	for (int i = 0; i < _globalParticleInfo.numParticles; i++) {
+		if (_masses[i] > 1.0f) count++;
+	}
+	return count;
+}
+
+double ParticleSystem2D::totalMass() const {
+	double mass = 0.0;
+	for (int i = 0; i < _globalParticleInfo.numParticles; i++) {
+		mass += _masses[i];
+	}
+	return mass;
+}
+
+void ParticleSystem2D::updateMaxSmoothingScale() {
+	_maxSmoothingScale = 1.0f;
+	for (int i = 0; i < _globalParticleInfo.numParticles; i++) {
+		_maxSmoothingScale = std::max(_maxSmoothingScale, _smoothingScales[i]);
+	}
+}
+
+void ParticleSystem2D::adaptParticleSizes() {
+	PROFILE_ZONE("Adapt Sizes");
+	enum : uint8_t { untouched, merged, absorbed };
+
+	int numParticles = _globalParticleInfo.numParticles;
+	if (numParticles == 0) return;
+
+	// Particles near the surface are missing the neighbors on one side, so their density is well below the fluid's mean. The mean
+	// (rather than the rest density) keeps the thresholds meaningful however compressed the fluid is. Summed serially, in index order
+	double densitySum = 0.0;
+	for (int i = 0; i < numParticles; i++) {
+		densitySum += _densities[i];
+	}
+	float meanDensity = static_cast<float>(densitySum / numParticles);
+	float splitDensity = _adaptivity.splitDensityRatio * meanDensity;
+	float mergeDensity = _adaptivity.mergeDensityRatio * meanDensity;
+	float smoothingRadius = _globalPhysics.densitySmoothingRadius;
+
+	// Merge partners are found with the spatial hash, so it has to describe the current positions
+	updateSpatialLookup<RenderedParticle2D>(_particles.data());
+	std::fill_n(_adaptFlags.begin(), numParticles, uint8_t{ untouched });
+
+	// Each bulk particle absorbs the nearest untouched bulk particle of the same mass within its smoothing length. The pass is serial and
+	// in index order, so the pairs don't depend on the thread count
+	for (int i = 0; i < numParticles; i++) {
+		if (_adaptFlags[i] != untouched || _densities[i] < mergeDensity || 2.0f * _masses[i] > _adaptivity.maxMass) continue;
+
+		uint32_t particleIndex = static_cast<uint32_t>(i);
+		float closestSquareDst = _smoothingScales[i] * smoothingRadius * _smoothingScales[i] * smoothingRadius;
+		int partner = -1;
+		loopThroughNearbyPoints(_particles[i].position, _particles.data(), [&](glm::vec2 dist, uint32_t index) {
+			if (index == particleIndex || _adaptFlags[index] != untouched || _masses[index] != _masses[i] || _densities[index] < mergeDensity) return;
+			float squareDst = glm::dot(dist, dist);
+			if (squareDst < closestSquareDst) {
+				closestSquareDst = squareDst;
+				partner = static_cast<int>(index);
 			}
-			}, start, end));
+		});
+		if (partner < 0) continue;
+
+		// The merged particle sits at the pair's center of mass and keeps its momentum
+		float mass = _masses[i] + _masses[partner];
+		float weight = _masses[partner] / mass;
+		_particles[i].position += weight * (_particles[partner].position - _particles[i].position);
+		_particles[i].velocity += weight * (_particles[partner].velocity - _particles[i].velocity);
+		_acceleration[i] += weight * (_acceleration[partner] - _acceleration[i]);
+		_masses[i] = mass;
+		_smoothingScales[i] = glm::sqrt(mass);
+		_sleeping[i] = 0;
+		_calmUpdates[i] = 0;
+		_adaptFlags[i] = merged;
+		_adaptFlags[partner] = absorbed;
 	}
+
+	// Remove the absorbed particles. Flags move with the particles (as do the densities), the split pass below still needs them
+	int i = 0;
+	while (i < numParticles) {
+		if (_adaptFlags[i] == absorbed) {
+			numParticles--;
+			moveParticle(numParticles, i);
+			_adaptFlags[i] = _adaptFlags[numParticles];
+		}
+		else {
+			i++;
+		}
+	}
+
+	// Coarse particles that reached the surface split in two, along a seeded random direction, with the same velocity
+	int numSplits = 0;
+	for (int j = 0; j < numParticles; j++) {
+		if (_adaptFlags[j] == untouched && _masses[j] > 1.0f && _densities[j] < splitDensity) numSplits++;
+	}
+	numSplits = std::min(numSplits, std::max(_particleLimit - numParticles, 0));
+	ensureCapacity(numParticles + numSplits);
+
+	int numCoarse = numParticles;
+	for (int j = 0; j < numCoarse && numSplits > 0; j++) {
+		if (_adaptFlags[j] != untouched || _masses[j] <= 1.0f || _densities[j] >= splitDensity) continue;
+
+		int child = numParticles++;
+		numSplits--;
+		float mass = 0.5f * _masses[j];
+		float scale = glm::sqrt(mass);
+		glm::vec2 offset = 0.25f * scale * smoothingRadius * getRandomDirection(_deterministic.seed, _stepCount, static_cast<uint32_t>(j), static_cast<uint32_t>(child));
+
+		moveParticle(j, child);
+		_masses[j] = _masses[child] = mass;
+		_smoothingScales[j] = _smoothingScales[child] = scale;
+		_sleeping[j] = _sleeping[child] = 0;
+		_calmUpdates[j] = _calmUpdates[child] = 0;
+		_particles[j].position -= offset;
+		_particles[child].position += offset;
+	}
+
+	_globalParticleInfo.numParticles = numParticles;
+	_lastParticleCount = numParticles;
+	updateMaxSmoothingScale();
 }
 
-static glm::vec2 getRandomDirection() {
-	// Random number generator for randomizing velocity (or position)
-	std::default_random_engine generator;
-	std::uniform_real_distribution<double> distribution(-1, 1);
+void ParticleSystem2D::setSleepSettings(SleepSettings settings) {
+	if (!settings.enabled && _sleep.enabled) {
+		wakeAllParticles();
+	}
+	_sleep = settings;
+}
+
+float ParticleSystem2D::activeFraction() const {
+	int numParticles = _globalParticleInfo.numParticles;
+	return numParticles > 0 ? static_cast<float>(activeParticleCount()) / numParticles : 1.0f;
+}
+
+void ParticleSystem2D::wakeAllParticles() {
+	std::fill(_sleeping.begin(), _sleeping.end(), uint8_t{ 0 });
+	std::fill(_calmUpdates.begin(), _calmUpdates.end(), uint16_t{ 0 });
+	std::fill(_sleepDensities.begin(), _sleepDensities.end(), 0.0f);
+	_activeParticles = _globalParticleInfo.numParticles;
+}
+
+void ParticleSystem2D::updateSleepStates() {
+	PROFILE_ZONE("Sleep States");
+	int numParticles = _globalParticleInfo.numParticles;
+	_activeParticles = numParticles;
+	if (numParticles == 0) return;
+
+	// Cells are keyed like the spatial lookup, from the current positions. Two cells sharing a key only ever keeps particles awake
+	uint32_t hashSize = static_cast<uint32_t>(numParticles);
+	float squareVelocityThreshold = _sleep.velocityThreshold * _sleep.velocityThreshold;
+	uint16_t calmUpdates = static_cast<uint16_t>(std::clamp(_sleep.calmUpdates, 0, static_cast<int>(UINT16_MAX)));
+	std::fill_n(_cellActive.begin(), numParticles, uint8_t{ 0 });
+
+	// A cell is active while any particle in it hasn't been calm for long enough. Both passes are serial and in index order, like the
+	// other passes that change the particle state outside of the force evaluation, so sleeping doesn't break deterministic runs
+	for (int i = 0; i < numParticles; i++) {
+		float density = _densities[i];
+		float velocitySquared = glm::dot(_particles[i].velocity, _particles[i].velocity);
+		bool calm = velocitySquared <= squareVelocityThreshold && glm::abs(density - _sleepDensities[i]) <= _sleep.densityChangeThreshold * _sleepDensities[i];
+		_sleepDensities[i] = density;
+		_calmUpdates[i] = calm ? static_cast<uint16_t>(std::min<int>(_calmUpdates[i] + 1, UINT16_MAX)) : uint16_t{ 0 };
+		if (_calmUpdates[i] < calmUpdates) {
+			_cellActive[hashGridCell(getGridCell(_particles[i].position, _cellSize), hashSize)] = 1;
+		}
+	}
+
+	// The hand wakes everything it may reach during the next update
+	bool handActive = _interactionHand && _interactionHand->isInteracting();
+	glm::vec2 handPosition = handActive ? _interactionHand->position() : glm::vec2{ 0.f, 0.f };
+	float wakeRadius = handActive ? _interactionHand->radius + _cellSize : 0.0f;
+
+	int active = 0;
+	for (int i = 0; i < numParticles; i++) {
+		glm::ivec2 center = getGridCell(_particles[i].position, _cellSize);
+		bool asleep = true;
+		for (auto& offset : gridCellOffsets) {
+			if (_cellActive[hashGridCell(center + offset, hashSize)]) {
+				asleep = false;
+				break;
+			}
+		}
+		if (asleep && handActive) {
+			glm::vec2 toHand = handPosition - _particles[i].position;
+			asleep = glm::dot(toHand, toHand) > wakeRadius * wakeRadius;
+		}
 
-	return glm::normalize(glm::vec2{ distribution(generator), distribution(generator) });
+		// Falling asleep drops what is left of the motion, so the particle stays exactly where it is, even under the leapfrog's half kick
+		if (asleep && !_sleeping[i]) {
+			_particles[i].velocity = glm::vec2{ 0.f, 0.f };
+			_acceleration[i] = glm::vec2{ 0.f, 0.f };
+		}
+		_sleeping[i] = asleep ? 1 : 0;
+		active += asleep ? 0 : 1;
+	}
+	_activeParticles = active;
 }
 
 float ParticleSystem2D::getPressure(float density) {
@@ -368,29 +773,30 @@ glm::vec2 ParticleSystem2D::calculatePressureForce(int particleIndex, ParticleTy
 
 		float squareDst = glm::dot(dist, dist);
 		// If particles are on top of each other, pick a random normal direction
-		glm::vec2 direction = (squareDst == 0.0f) ? getRandomDirection() : dist / glm::sqrt(squareDst);
+		glm::vec2 direction = (squareDst == 0.0f) ? getRandomDirection(_deterministic.seed, _stepCount, particleIndex, index) : dist / glm::sqrt(squareDst);
 
 		// The pressure force needs to follow newton's third law, so instead of using the particles full pressure, take the average between particle index and particle j
 		// Then multiply with the opposite direction to
-		force += getSharedPressure(densities[particleIndex], densities[index]) * direction * SmoothingKernels2D::spikeyDerivative(squareDst, _globalPhysics.densitySmoothingRadius) / densities[index];
+		float smoothingLength = pairSmoothingLength(particleIndex, index);
+		force += _masses[index] * getSharedPressure(densities[particleIndex], densities[index]) * direction * SmoothingKernels2D::spikeyDerivative(squareDst, smoothingLength) / densities[index];
 	});
 	return force;
 }
 
-static const std::vector<glm::ivec2> gridCellOffsets {
-	{1, 1}, {1, 0}, {1, -1},
-	{0, 1}, {0, -1}, {0, 0},
-	{-1, 0}, {-1, 1}, {-1, -1}
-};
-
 template<typename ParticleType>
 void ParticleSystem2D::loopThroughNearbyPoints(glm::vec2 particlePosition, ParticleType* particles, std::function<void(glm::vec2, uint32_t)> callback) {
-	// Get the center grid cell
-	glm::ivec2 center = getGridCell(particlePosition, _globalPhysics.densitySmoothingRadius);
-	float squareSmoothingRadius = _globalPhysics.densitySmoothingRadius * _globalPhysics.densitySmoothingRadius;
+	// Get the center grid cell. Cells are as large as the largest smoothing length, so the 3x3 block around the particle holds every
+	// neighbor of any size; the kernels themselves cut off at each pair's own smoothing length
+	glm::ivec2 center = getGridCell(particlePosition, _cellSize);
+	float squareSmoothingRadius = _cellSize * _cellSize;
 
+	uint32_t visitedKeys[9];
+	int numVisitedKeys = 0;
 	for (auto& offset : gridCellOffsets) {
 		uint32_t gridKey = hashGridCell(center + offset, _globalParticleInfo.numParticles);
+		// Two neighboring cells can hash to the same key. Visiting the key twice would count its particles twice
+		if (std::find(visitedKeys, visitedKeys + numVisitedKeys, gridKey) != visitedKeys + numVisitedKeys) continue;
+		visitedKeys[numVisitedKeys++] = gridKey;
 		uint32_t cellStartIndex = _startIndices[gridKey];
 
 		// Loop through the rest of the particles in the grid cell
@@ -408,35 +814,54 @@ void ParticleSystem2D::loopThroughNearbyPoints(glm::vec2 particlePosition, Parti
 	}
 }
 
-// TODO: Make this more efficient using the same grid system as the fluid simulation calculations
 void ParticleSystem2D::resolveParticleCollisions() {
-	// Brute-force collision detection
-	for (int i = 0; i < _globalParticleInfo.numParticles; i++) {
-		for (int j = i + 1; j < _globalParticleInfo.numParticles; j++) {
-
-			// Calculate the normalized vector pointing from particle i to j
-			glm::vec2 itojDirection = _particles[j].position - _particles[i].position;
-			float distance = norm(itojDirection); // Distance between the two particles
-
-			// Check to see if the particles collide
-			if (distance < 2.0f * _globalParticleInfo.radius) {
-				itojDirection = itojDirection / distance; // normalize the vector
-
-				// Update the colliding particles' positions
-				float posCorrection = 0.5f * (2.0f * _globalParticleInfo.radius - distance); // how much to move the particles after colliding
-				_particles[i].position += -posCorrection * itojDirection;
-				_particles[j].position += posCorrection * itojDirection;
-
-				// Update the colliding particles' velocities
-				// Compute the velocities in the direction of the collision
-				float v1 = glm::dot(_particles[i].velocity, itojDirection);
-				float v2 = glm::dot(_particles[j].velocity, itojDirection);
-				// Update the particles' velocities
-				_particles[i].velocity += ((0.5f * (v1 + v2 - (v1 - v2) * _globalPhysics.collisionDampingFactor)) - v1) * itojDirection;
-				_particles[j].velocity += ((0.5f * (v1 + v2 - (v2 - v1) * _globalPhysics.collisionDampingFactor)) - v2) * itojDirection;
-			}
+	PROFILE_ZONE("Particle Collisions");
+	// Collisions are found with the same spatial hash as the fluid forces, so it has to describe the current positions
+	updateSpatialLookup<RenderedParticle2D>(_particles.data());
+
+	float collisionDistance = 2.0f * _globalParticleInfo.radius;
+	float squareCollisionDistance = collisionDistance * collisionDistance;
+
+	// Jacobi-style resolution: every particle reads the old state and accumulates only its own corrections, so the batches never
+	// write to the same particle and the result doesn't depend on the thread count or scheduling
+	runBatchesParallel("Collision Batch", [this, collisionDistance, squareCollisionDistance](int startIndex, int endIndex) {
+		for (int i = startIndex; i < endIndex; i++) {
+			glm::vec2 positionCorrection{ 0.f, 0.f };
+			glm::vec2 velocityCorrection{ 0.f, 0.f };
+			uint32_t particleIndex = static_cast<uint32_t>(i);
+
+			loopThroughNearbyPoints(_particles[i].position, _particles.data(), [&](glm::vec2 dist, uint32_t otherIndex) {
+				if (otherIndex == particleIndex) return;
+
+				float squareDst = glm::dot(dist, dist);
+				if (squareDst >= squareCollisionDistance) return;
+
+				// Calculate the normalized vector pointing from particle i to the other particle. Particles on top of each other are
+				// separated along x, ordered by index so the pair gets opposite directions
+				float distance = glm::sqrt(squareDst);
+				glm::vec2 itojDirection = (distance > 0.0f) ? dist / distance : glm::vec2{ particleIndex < otherIndex ? 1.0f : -1.0f, 0.0f };
+
+				// Each particle of the pair moves half of the overlap away from the other
+				positionCorrection -= 0.5f * (collisionDistance - distance) * itojDirection;
+
+				// Compute the velocities in the direction of the collision and keep this particle's half of the damped exchange
+				float v1 = glm::dot(_particles[particleIndex].velocity, itojDirection);
+				float v2 = glm::dot(_particles[otherIndex].velocity, itojDirection);
+				velocityCorrection += ((0.5f * (v1 + v2 - (v1 - v2) * _globalPhysics.collisionDampingFactor)) - v1) * itojDirection;
+			});
+
+			_collisionPositionCorrection[i] = positionCorrection;
+			_collisionVelocityCorrection[i] = velocityCorrection;
 		}
-	}
+	});
+
+	// Apply the accumulated corrections only once every particle has read the old state
+	runBatchesParallel("Collision Apply Batch", [this](int startIndex, int endIndex) {
+		for (int i = startIndex; i < endIndex; i++) {
+			_particles[i].position += _collisionPositionCorrection[i];
+			_particles[i].velocity += _collisionVelocityCorrection[i];
+		}
+	});
 }
 
 void ParticleSystem2D::sortSpatialArrays() {
@@ -449,8 +874,9 @@ void ParticleSystem2D::sortSpatialArrays() {
 		indices[i] = i;
 	}
 
-	// Sort the indices array based on the given lambda function comparing the spatial lookup array
-	std::sort(indices, indices + numParticles, [&](uint32_t i, uint32_t j) {
+	// Sort the indices array based on the given lambda function comparing the spatial lookup array. The sort is stable so the particles
+	// of a cell stay in index order, which fixes the order every neighbor sum adds up in on any standard library
+	std::stable_sort(indices, indices + numParticles, [&](uint32_t i, uint32_t j) {
 			return _spatialLookup[i] < _spatialLookup[j];
 		});
 
@@ -475,21 +901,30 @@ void ParticleSystem2D::sortSpatialArrays() {
 
 template<typename ParticleType>
 void ParticleSystem2D::updateSpatialLookup(ParticleType* particles) {
+	computeSpatialKeys<ParticleType>(particles);
+
+	// Sort _particleIndices and _spatialLookup based on _spatialLookup
+	sortSpatialArrays();
+
+	computeStartIndices();
+}
 
+template<typename ParticleType>
+void ParticleSystem2D::computeSpatialKeys(ParticleType* particles) {
+	_cellSize = _globalPhysics.densitySmoothingRadius * _maxSmoothingScale;
 	for (int i = 0; i < _globalParticleInfo.numParticles; i++) {
 		// First, get the spatial grid cell index and its hash value
 		glm::ivec2 gridCellIndex{ 0, 0 };
-		gridCellIndex = getGridCell(particles[i].position, _globalPhysics.densitySmoothingRadius);
+		gridCellIndex = getGridCell(particles[i].position, _cellSize);
 		uint32_t gridCellHashValue = hashGridCell(gridCellIndex, _globalParticleInfo.numParticles);
 
 		_particleIndices[i] = i;
 		_spatialLookup[i] = gridCellHashValue;
 		_startIndices[i] = INT_MAX; // reset the start indices
 	}
+}
 
-	// Sort _particleIndices and _spatialLookup based on _spatialLookup
-	sortSpatialArrays();
-
+void ParticleSystem2D::computeStartIndices() {
 	// Calculate the start indices for each non-empty grid cell
 	for (int i = 0; i < _globalParticleInfo.numParticles; i++) {
 		uint32_t gridKey = _spatialLookup[i];
@@ -501,23 +936,23 @@ void ParticleSystem2D::updateSpatialLookup(ParticleType* particles) {
 }
 
 void ParticleSystem2D::assignInputEvents() {
-	if (!_interactionHand) return;
-	_inputManager.addListener(InputEvent::leftMouseDown, [&]() {
+	if (!_inputManager || !_interactionHand) return;
+	_inputManager->addListener(InputEvent::leftMouseDown, [&]() {
 		_interactionHand->setAction(HandAction::pushing);
 	});
-	_inputManager.addListener(InputEvent::leftMouseUp, [&]() {
+	_inputManager->addListener(InputEvent::leftMouseUp, [&]() {
 		_interactionHand->setAction(HandAction::idle);
 	});
-	_inputManager.addListener(InputEvent::rightMouseUp, [&]() {
+	_inputManager->addListener(InputEvent::rightMouseUp, [&]() {
 		_interactionHand->setAction(HandAction::idle);
 	});
-	_inputManager.addListener(InputEvent::rightMouseDown, [&]() {
+	_inputManager->addListener(InputEvent::rightMouseDown, [&]() {
 		_interactionHand->setAction(HandAction::pulling);
 	});
-	_inputManager.addListener(InputEvent::spacebarDown, [&]() {
+	_inputManager->addListener(InputEvent::spacebarDown, [&]() {
 		_simulationPaused = _simulationPaused ? false : true;
 	});
-	_inputManager.addListener(InputEvent::rightArrowDown, [&]() {
+	_inputManager->addListener(InputEvent::rightArrowDown, [&]() {
 		if (_simulationPaused) {
 			proceedFrame();
 		}
@@ -532,6 +967,18 @@ void ParticleSystem2D::frameDone() {
 	_doOneFrame = false;
 }
 
+// Integrators evaluate forces on both the rendered particles and their own scratch state
+template void ParticleSystem2D::computeAccelerations<RenderedParticle2D>(RenderedParticle2D* particles, glm::vec2* outputAccel);
+template void ParticleSystem2D::computeAccelerations<Particle2D>(Particle2D* particles, glm::vec2* outputAccel);
+
+// The individual phases are instantiated too, so subclasses (e.g. the physics benchmark) can run and time them separately
+template void ParticleSystem2D::updateSpatialLookup<RenderedParticle2D>(RenderedParticle2D* particles);
+template void ParticleSystem2D::computeSpatialKeys<RenderedParticle2D>(RenderedParticle2D* particles);
+template void ParticleSystem2D::calculateParticleDensitiesParallel<RenderedParticle2D>(RenderedParticle2D* particles);
+template float ParticleSystem2D::calculateDensity<RenderedParticle2D>(uint32_t particleIndex, RenderedParticle2D* particles);
+template void ParticleSystem2D::getAccelerationParallel<RenderedParticle2D>(glm::vec2* outputAccel, RenderedParticle2D* particles);
+template glm::vec2 ParticleSystem2D::calculatePressureForce<RenderedParticle2D>(int particleIndex, RenderedParticle2D* particles, float* densities);
+
 // ----------------------------------------------- SMOOTHING KERNELS --------------------------------------------- //
 
 float SmoothingKernels2D::smooth(float squareDst, float smoothingRadius) {
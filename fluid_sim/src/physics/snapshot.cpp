@@ -0,0 +1,99 @@
+#include "physics/snapshot.h"
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+// Version 1 headers end where the version 2 fields start
+static const size_t versionOneHeaderSize = offsetof(SnapshotHeader, massOffset);
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+Snapshot::Snapshot(const std::string& path) : _file(path), _header{} {
+	if (_file.size() < versionOneHeaderSize) {
+		throw std::runtime_error("Snapshot is too small to hold a header: " + path);
+	}
+	// Only the part of the header the file's version has is read, the newer fields stay zero
+	std::memcpy(&_header, _file.data(), versionOneHeaderSize);
+
+	if (std::memcmp(_header.magic, magic, sizeof(magic)) != 0) {
+		throw std::runtime_error("Not a snapshot file: " + path);
+	}
+	if (_header.byteOrder != byteOrderMark) {
+		throw std::runtime_error("Snapshot was saved on a machine with a different byte order: " + path);
+	}
+	if (_header.version == 0 || _header.version > currentVersion) {
+		throw std::runtime_error("Unsupported snapshot version " + std::to_string(_header.version) + ": " + path);
+	}
+	size_t headerSize = _header.version == 1 ? versionOneHeaderSize : sizeof(SnapshotHeader);
+	if (_header.headerSize != headerSize || _header.particleSize != sizeof(RenderedParticle2D) || _file.size() < headerSize) {
+		throw std::runtime_error("Snapshot was saved by a build with a different data layout: " + path);
+	}
+	std::memcpy(&_header, _file.data(), headerSize);
+
+	if (_header.integratorType > static_cast<uint32_t>(IntegratorType::leapfrog)) {
+		throw std::runtime_error("Snapshot uses an unknown integrator: " + path);
+	}
+	if (_header.numParticles < 0) {
+		throw std::runtime_error("Snapshot is corrupt: " + path);
+	}
+
+	uint64_t numParticles = static_cast<uint64_t>(_header.numParticles);
+	auto arrayFits = [&](uint64_t offset, uint64_t elementSize) {
+		return offset % particleAlignment == 0 && offset <= _file.size() && numParticles * elementSize <= _file.size() - offset;
+	};
+	bool valid = arrayFits(_header.particleOffset, _header.particleSize) && arrayFits(_header.accelerationOffset, sizeof(glm::vec2));
+	if (hasMasses()) {
+		valid = valid && arrayFits(_header.massOffset, sizeof(float)) && arrayFits(_header.smoothingScaleOffset, sizeof(float));
+	}
+	if (!valid) {
+		throw std::runtime_error("Snapshot is truncated or corrupt: " + path);
+	}
+}
+
+void Snapshot::write(const std::string& path, SnapshotHeader header, const RenderedParticle2D* particles, const glm::vec2* accelerations,
+	const float* masses, const float* smoothingScales) {
+	uint64_t numParticles = static_cast<uint64_t>(header.numParticles);
+	struct Array {
+		const void* data;
+		uint64_t bytes;
+		uint64_t* offset;
+	};
+	Array arrays[] = {
+		{ particles, numParticles * sizeof(RenderedParticle2D), &header.particleOffset },
+		{ accelerations, numParticles * sizeof(glm::vec2), &header.accelerationOffset },
+		{ masses, numParticles * sizeof(float), &header.massOffset },
+		{ smoothingScales, numParticles * sizeof(float), &header.smoothingScaleOffset }
+	};
+
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = currentVersion;
+	header.byteOrder = byteOrderMark;
+	header.headerSize = sizeof(SnapshotHeader);
+	header.particleSize = sizeof(RenderedParticle2D);
+	uint64_t end = sizeof(SnapshotHeader);
+	for (Array& array : arrays) {
+		*array.offset = alignUp(end, particleAlignment);
+		end = *array.offset + array.bytes;
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		throw std::runtime_error("Failed to open snapshot for writing: " + path);
+	}
+
+	// Zeros fill the gaps in front of the aligned arrays
+	char padding[particleAlignment]{};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(SnapshotHeader));
+	end = sizeof(SnapshotHeader);
+	for (const Array& array : arrays) {
+		file.write(padding, static_cast<std::streamsize>(*array.offset - end));
+		file.write(static_cast<const char*>(array.data), static_cast<std::streamsize>(array.bytes));
+		end = *array.offset + array.bytes;
+	}
+	if (!file) {
+		throw std::runtime_error("Failed to write snapshot: " + path);
+	}
+}
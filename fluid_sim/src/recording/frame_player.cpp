@@ -0,0 +1,94 @@
+#include "recording/frame_player.h"
+#include "physics/particle_system.h"
+#include "utility/profiler.h"
+#include <cstring>
+#include <stdexcept>
+
+// @brief Reads and validates the stream header at the start of file
+static FrameStreamHeader readStreamHeader(const MappedFile& file) {
+	FrameStreamHeader header{};
+	if (file.size() < sizeof(FrameStreamHeader)) {
+		throw std::runtime_error("Recording is too small to hold a header: " + file.path());
+	}
+	std::memcpy(&header, file.data(), sizeof(FrameStreamHeader));
+	if (std::memcmp(header.magic, frameStreamMagic, sizeof(frameStreamMagic)) != 0) {
+		throw std::runtime_error("Not a recording: " + file.path());
+	}
+	if (header.byteOrder != frameStreamByteOrder || header.version != frameStreamVersion) {
+		throw std::runtime_error("Unsupported recording version or byte order: " + file.path());
+	}
+	return header;
+}
+
+FramePlayer::FramePlayer(const std::string& path) :
+	_file(path),
+	_header(readStreamHeader(_file)),
+	_frameCount(0),
+	_decoder(_header),
+	_chunk(0),
+	_frameInChunk(0),
+	_cursor(nullptr),
+	_position(0) {
+
+	// Walk the chunk headers once, so seeking can jump straight to a chunk
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(_file.data());
+	const uint8_t* end = data + _file.size();
+	const uint8_t* cursor = data + sizeof(FrameStreamHeader);
+	while (end - cursor >= static_cast<ptrdiff_t>(sizeof(ChunkHeader))) {
+		ChunkHeader chunk;
+		std::memcpy(&chunk, cursor, sizeof(ChunkHeader));
+		cursor += sizeof(ChunkHeader);
+		// A recording cut off mid-chunk (e.g. by a crash) still plays up to its last complete chunk
+		if (std::memcmp(chunk.magic, frameChunkMagic, sizeof(frameChunkMagic)) != 0 || chunk.payloadBytes > static_cast<uint64_t>(end - cursor)) break;
+
+		_chunks.push_back(ChunkEntry{ cursor, cursor + chunk.payloadBytes, chunk.numFrames });
+		_frameCount += chunk.numFrames;
+		cursor += chunk.payloadBytes;
+	}
+	if (_frameCount == 0) {
+		throw std::runtime_error("Recording holds no frames: " + path);
+	}
+	seek(0);
+}
+
+void FramePlayer::seek(uint64_t frame) {
+	frame %= _frameCount;
+	_chunk = 0;
+	uint64_t chunkStart = 0;
+	while (chunkStart + _chunks[_chunk].numFrames <= frame) {
+		chunkStart += _chunks[_chunk].numFrames;
+		_chunk++;
+	}
+	_frameInChunk = 0;
+	_cursor = _chunks[_chunk].payload;
+	_position = chunkStart;
+
+	// Frames are deltas of the one before, so decode forward from the chunk's keyframe
+	while (_position < frame) {
+		nextFrame();
+	}
+}
+
+const RawFrame& FramePlayer::nextFrame() {
+	PROFILE_ZONE("Decode Frame");
+	if (_frameInChunk >= _chunks[_chunk].numFrames) {
+		_chunk = (_chunk + 1) % _chunks.size();
+		_frameInChunk = 0;
+		_cursor = _chunks[_chunk].payload;
+		if (_chunk == 0) _position = 0;
+	}
+
+	_cursor = _decoder.decode(_cursor, _chunks[_chunk].end, _frame);
+	_frameInChunk++;
+	_position++;
+	return _frame;
+}
+
+void FramePlayer::copyParticles(RenderedParticle2D* particles, glm::vec4 color) const {
+	bool hasVelocities = !_frame.velocities.empty();
+	for (int i = 0; i < _frame.numParticles; i++) {
+		particles[i].position = _frame.positions[i];
+		particles[i].velocity = hasVelocities ? _frame.velocities[i] : glm::vec2{ 0.0f, 0.0f };
+		particles[i].color = color;
+	}
+}
@@ -0,0 +1,160 @@
+#include "recording/frame_recorder.h"
+#include "physics/particle_system.h"
+#include "utility/profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+FrameRecorder::FrameRecorder(const std::string& path, RecorderSettings settings) :
+	_path(path),
+	_settings(settings),
+	_file(path, std::ios::binary | std::ios::trunc),
+	_header{},
+	_stopping(false),
+	_nextFrame(0),
+	_time(0.0f) {
+
+	if (!_file) {
+		throw std::runtime_error("Failed to create recording: " + path);
+	}
+
+	std::memcpy(_header.magic, frameStreamMagic, sizeof(frameStreamMagic));
+	_header.version = frameStreamVersion;
+	_header.byteOrder = frameStreamByteOrder;
+	_header.channels = _settings.channels;
+	_header.framesPerChunk = std::max(_settings.framesPerChunk, 1u);
+	_header.maxSpeed = _settings.maxSpeed;
+	_header.maxDensity = _settings.maxDensity;
+	_file.write(reinterpret_cast<const char*>(&_header), sizeof(FrameStreamHeader));
+	if (!_file) {
+		throw std::runtime_error("Failed to write recording header: " + path);
+	}
+	_bytesWritten = sizeof(FrameStreamHeader);
+
+	// One slot per queued frame, plus the one the I/O thread is encoding
+	for (int i = 0; i < std::max(_settings.queueCapacity, 1) + 1; i++) {
+		_freeFrames.push_back(std::make_unique<RawFrame>());
+	}
+
+	_thread = std::thread(&FrameRecorder::run, this);
+}
+
+FrameRecorder::~FrameRecorder() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_condition.notify_one();
+	_thread.join();
+}
+
+bool FrameRecorder::record(const ParticleSystem2D& system, float deltaTime) {
+	PROFILE_ZONE("Record Frame");
+	if (failed()) return false; // The I/O thread has stopped, nothing would take the frame off the queue
+	_time += deltaTime;
+	uint64_t frameNumber = _nextFrame++;
+
+	std::unique_ptr<RawFrame> frame;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_freeFrames.empty() || static_cast<int>(_queue.size()) >= _settings.queueCapacity) {
+			_framesDropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		frame = std::move(_freeFrames.back());
+		_freeFrames.pop_back();
+	}
+
+	// Copy outside the lock, the I/O thread never touches a frame that isn't queued
+	int numParticles = system.particleInfo().numParticles;
+	const RenderedParticle2D* particles = system.particles();
+	const BoundingBox& box = system.boundingBox();
+	frame->frame = frameNumber;
+	frame->time = _time;
+	frame->numParticles = numParticles;
+	frame->boundsMin = glm::vec2{ box.left, box.bottom };
+	frame->boundsMax = glm::vec2{ box.right, box.top };
+	frame->positions.resize(numParticles);
+	frame->velocities.resize(_settings.channels & frameChannelVelocity ? numParticles : 0);
+	frame->densities.resize(_settings.channels & frameChannelDensity ? numParticles : 0);
+	for (int i = 0; i < numParticles; i++) {
+		frame->positions[i] = particles[i].position;
+	}
+	if (_settings.channels & frameChannelVelocity) {
+		for (int i = 0; i < numParticles; i++) {
+			frame->velocities[i] = particles[i].velocity;
+		}
+	}
+	if (_settings.channels & frameChannelDensity) {
+		std::memcpy(frame->densities.data(), system.densities(), sizeof(float) * numParticles);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_queue.push_back(std::move(frame));
+	}
+	_condition.notify_one();
+	return true;
+}
+
+void FrameRecorder::run() {
+	Profiler::getProfiler().setThreadName("Recorder");
+
+	FrameEncoder encoder(_header);
+	std::vector<uint8_t> payload;
+	ChunkHeader chunk{};
+	std::memcpy(chunk.magic, frameChunkMagic, sizeof(frameChunkMagic));
+
+	while (true) {
+		std::unique_ptr<RawFrame> frame;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [this]() { return _stopping || !_queue.empty(); });
+			if (_queue.empty()) break; // Stopping, and everything queued is written
+			frame = std::move(_queue.front());
+			_queue.pop_front();
+		}
+
+		{
+			PROFILE_ZONE("Encode Frame");
+			if (chunk.numFrames == 0) {
+				chunk.firstFrame = frame->frame;
+			}
+			encoder.encode(*frame, chunk.numFrames == 0, payload);
+			chunk.numFrames++;
+		}
+		_framesRecorded.fetch_add(1, std::memory_order_relaxed);
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_freeFrames.push_back(std::move(frame));
+		}
+
+		if (chunk.numFrames >= _header.framesPerChunk) {
+			if (!writeChunk(chunk, payload)) return;
+			chunk.numFrames = 0;
+			payload.clear();
+		}
+	}
+
+	if (chunk.numFrames > 0) {
+		writeChunk(chunk, payload);
+	}
+}
+
+bool FrameRecorder::writeChunk(const ChunkHeader& header, const std::vector<uint8_t>& payload) {
+	PROFILE_ZONE("Write Chunk");
+	ChunkHeader chunk = header;
+	chunk.payloadBytes = payload.size();
+	_file.write(reinterpret_cast<const char*>(&chunk), sizeof(ChunkHeader));
+	_file.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+	// Flushing each chunk makes a full disk show up here rather than when the file is closed
+	_file.flush();
+	if (!_file) {
+		_error = "Failed to write to recording " + _path + ", recording stopped";
+		_failed.store(true, std::memory_order_release);
+		return false;
+	}
+	_bytesWritten.fetch_add(sizeof(ChunkHeader) + payload.size(), std::memory_order_relaxed);
+	return true;
+}
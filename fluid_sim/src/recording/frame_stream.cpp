@@ -0,0 +1,153 @@
+#include "recording/frame_stream.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static const float quantizationSteps = 65535.0f;
+
+uint32_t componentsPerParticle(uint32_t channels) {
+	uint32_t components = 2;
+	if (channels & frameChannelVelocity) components += 2;
+	if (channels & frameChannelDensity) components += 1;
+	return components;
+}
+
+static uint16_t quantize(float value, float min, float max) {
+	float normalized = max > min ? (value - min) / (max - min) : 0.0f;
+	return static_cast<uint16_t>(std::clamp(normalized, 0.0f, 1.0f) * quantizationSteps + 0.5f);
+}
+
+static float dequantize(uint16_t value, float min, float max) {
+	return min + (static_cast<float>(value) / quantizationSteps) * (max - min);
+}
+
+// @brief Maps signed deltas to unsigned so small negative deltas also get short varints: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+static uint32_t zigzag(int32_t value) {
+	return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+	return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+static void writeVarint(uint32_t value, std::vector<uint8_t>& output) {
+	while (value >= 0x80) {
+		output.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	output.push_back(static_cast<uint8_t>(value));
+}
+
+static uint32_t readVarint(const uint8_t*& data, const uint8_t* end) {
+	uint32_t value = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		if (data >= end) {
+			throw std::runtime_error("Recording frame is truncated");
+		}
+		uint8_t byte = *data++;
+		value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) return value;
+	}
+	throw std::runtime_error("Recording frame holds an invalid varint");
+}
+
+void FrameEncoder::encode(const RawFrame& frame, bool keyframe, std::vector<uint8_t>& output) {
+	int numParticles = frame.numParticles;
+	uint32_t components = componentsPerParticle(_header.channels);
+
+	// Deltas are only meaningful when both frames were quantized over the same range
+	keyframe = keyframe || frame.boundsMin != _previousMin || frame.boundsMax != _previousMax;
+	_previous.resize(static_cast<size_t>(components) * numParticles, 0);
+	if (keyframe) {
+		std::fill(_previous.begin(), _previous.end(), uint16_t{ 0 });
+	}
+	_previousMin = frame.boundsMin;
+	_previousMax = frame.boundsMax;
+
+	size_t headerOffset = output.size();
+	output.resize(headerOffset + sizeof(FrameHeader));
+	size_t payloadStart = output.size();
+
+	// The payload is component-major (all the x positions, then all the y positions, ...) so similar deltas sit next to each other
+	uint32_t component = 0;
+	auto encodeComponent = [&](auto&& valueAt, float min, float max) {
+		for (int i = 0; i < numParticles; i++) {
+			uint16_t& previous = _previous[static_cast<size_t>(i) * components + component];
+			uint16_t value = quantize(valueAt(i), min, max);
+			writeVarint(zigzag(static_cast<int32_t>(value) - static_cast<int32_t>(previous)), output);
+			previous = value;
+		}
+		component++;
+	};
+
+	encodeComponent([&](int i) { return frame.positions[i].x; }, frame.boundsMin.x, frame.boundsMax.x);
+	encodeComponent([&](int i) { return frame.positions[i].y; }, frame.boundsMin.y, frame.boundsMax.y);
+	if (_header.channels & frameChannelVelocity) {
+		encodeComponent([&](int i) { return frame.velocities[i].x; }, -_header.maxSpeed, _header.maxSpeed);
+		encodeComponent([&](int i) { return frame.velocities[i].y; }, -_header.maxSpeed, _header.maxSpeed);
+	}
+	if (_header.channels & frameChannelDensity) {
+		encodeComponent([&](int i) { return frame.densities[i]; }, 0.0f, _header.maxDensity);
+	}
+
+	FrameHeader header{
+		.frame = frame.frame,
+		.time = frame.time,
+		.numParticles = numParticles,
+		.keyframe = keyframe ? 1u : 0u,
+		.payloadBytes = static_cast<uint32_t>(output.size() - payloadStart),
+		.boundsMin = frame.boundsMin,
+		.boundsMax = frame.boundsMax
+	};
+	std::memcpy(output.data() + headerOffset, &header, sizeof(FrameHeader));
+}
+
+const uint8_t* FrameDecoder::decode(const uint8_t* data, const uint8_t* end, RawFrame& frame) {
+	FrameHeader header;
+	if (end - data < static_cast<ptrdiff_t>(sizeof(FrameHeader))) {
+		throw std::runtime_error("Recording frame header is truncated");
+	}
+	std::memcpy(&header, data, sizeof(FrameHeader));
+	data += sizeof(FrameHeader);
+	const uint8_t* payloadEnd = data + header.payloadBytes;
+	if (header.numParticles < 0 || payloadEnd > end) {
+		throw std::runtime_error("Recording frame is truncated or corrupt");
+	}
+
+	int numParticles = header.numParticles;
+	uint32_t components = componentsPerParticle(_header.channels);
+	_previous.resize(static_cast<size_t>(components) * numParticles, 0);
+	if (header.keyframe) {
+		std::fill(_previous.begin(), _previous.end(), uint16_t{ 0 });
+	}
+
+	frame.frame = header.frame;
+	frame.time = header.time;
+	frame.numParticles = numParticles;
+	frame.boundsMin = header.boundsMin;
+	frame.boundsMax = header.boundsMax;
+	frame.positions.resize(numParticles);
+	frame.velocities.resize(_header.channels & frameChannelVelocity ? numParticles : 0);
+	frame.densities.resize(_header.channels & frameChannelDensity ? numParticles : 0);
+
+	uint32_t component = 0;
+	auto decodeComponent = [&](auto&& store, float min, float max) {
+		for (int i = 0; i < numParticles; i++) {
+			uint16_t& previous = _previous[static_cast<size_t>(i) * components + component];
+			previous = static_cast<uint16_t>(static_cast<int32_t>(previous) + unzigzag(readVarint(data, payloadEnd)));
+			store(i, dequantize(previous, min, max));
+		}
+		component++;
+	};
+
+	decodeComponent([&](int i, float value) { frame.positions[i].x = value; }, header.boundsMin.x, header.boundsMax.x);
+	decodeComponent([&](int i, float value) { frame.positions[i].y = value; }, header.boundsMin.y, header.boundsMax.y);
+	if (_header.channels & frameChannelVelocity) {
+		decodeComponent([&](int i, float value) { frame.velocities[i].x = value; }, -_header.maxSpeed, _header.maxSpeed);
+		decodeComponent([&](int i, float value) { frame.velocities[i].y = value; }, -_header.maxSpeed, _header.maxSpeed);
+	}
+	if (_header.channels & frameChannelDensity) {
+		decodeComponent([&](int i, float value) { frame.densities[i] = value; }, 0.0f, _header.maxDensity);
+	}
+	return payloadEnd;
+}
@@ -1,19 +1,23 @@
 #include "render_systems/particle_render_system.h"
+#include "utility/logger.h"
+#include <array>
 
-void ParticleRenderSystem::buildPipeline() {
-
-	_renderer.pipelineBuilder().clear();
-
+std::string ParticleRenderSystem::shaderDirectory() {
 	std::string baseDir = static_cast<std::string>(BASE_DIR);
 	std::string projectName = "fluid_sim";
-	std::string folderDir = baseDir + "\\" + projectName + "\\shaders\\";
+	return baseDir + "/" + projectName + "/shaders/";
+}
+
+void ParticleRenderSystem::buildPipeline(bool buildAsync) {
+
+	_renderer.pipelineBuilder().clear();
 
-	Shader defaultVertShader(_renderer.device(), folderDir + "circle.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-	Shader defaultFragShader(_renderer.device(), folderDir + "circle.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+	std::string folderDir = shaderDirectory();
 
-	Pipeline pipeline = _renderer.pipelineBuilder().setVertexInputState(PipelineBuilder::vertexInputStateCreateInfo())
-		.setShader(defaultVertShader)
-		.setShader(defaultFragShader)
+	ShaderLibrary& shaders = _renderer.shaderLibrary();
+	_renderer.pipelineBuilder().setVertexInputState(PipelineBuilder::vertexInputStateCreateInfo())
+		.setShader(shaders.load(folderDir + "circle.vert.spv", VK_SHADER_STAGE_VERTEX_BIT))
+		.setShader(shaders.load(folderDir + "circle.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT))
 		.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
 		.setPolygonMode(VK_POLYGON_MODE_FILL)
 		.setCullMode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE)
@@ -21,27 +25,76 @@ void ParticleRenderSystem::buildPipeline() {
 		.setBlending(false)
 		.setDepthTest()
 		.setColorAttachmentFormat(_renderer.swapchain().imageFormat())
-		.addDescriptors(_particleDescriptors)
-		.buildPipeline();
+		.addDescriptors({ _renderer.bindlessTable().layout(), _renderer.uploadHeap().layout() })
+		.addPushConstants({ _renderer.bindlessTable().pushConstantRange() });
 
-	_pipelines.push_back(std::move(pipeline));
+	if (buildAsync) {
+		_pendingPipeline = _renderer.pipelineBuilder().buildPipelineAsync();
+	}
+	else {
+		_pipelines.push_back(_renderer.pipelineBuilder().buildPipeline());
+	}
+	_renderer.pipelineBuilder().clear(); // The builder (or the background build's copy) no longer needs the shaders held
 }
 
-ParticleRenderSystem::ParticleRenderSystem(Renderer& renderer, std::vector<VkDescriptorSetLayout> particleDescriptorLayout, std::vector<VkDescriptorSet> particleDescriptorSets, ParticleSystem2D& particleSystem) :
+ParticleRenderSystem::ParticleRenderSystem(Renderer& renderer, ParticleDrawIndices drawIndices, ParticleSystem2D& particleSystem, bool buildAsync) :
 	RenderSystem(renderer), 
-	_particleDescriptors(particleDescriptorLayout),
-	_particleSet(particleDescriptorSets),
-	_particleSystem(particleSystem) {
+	_particleSystem(particleSystem),
+	_drawIndices(drawIndices),
+	_globalsOffset(0),
+	_particleCount(particleSystem.particleInfo().numParticles) {
 
-	buildPipeline();
+	buildPipeline(buildAsync);
+
+	// A reload is always built in the background, the current pipeline keeps drawing until the new one is ready. Reloading while an
+	// earlier reload is still building waits for that build and drops its result
+	std::string folderDir = shaderDirectory();
+	_shaderListener = _renderer.shaderHotReloader().addListener({ folderDir + "circle.vert.spv", folderDir + "circle.frag.spv" }, [this]() {
+		try {
+			buildPipeline(true);
+		}
+		catch (const std::exception& e) {
+			Logger::getLogger().print(std::string("Particle pipeline reload failed: ") + e.what());
+		}
+	});
+}
+
+ParticleRenderSystem::~ParticleRenderSystem() {
+	_renderer.shaderHotReloader().removeListener(_shaderListener);
 }
 
 void ParticleRenderSystem::render(Command& cmd) {
+	// Swap in the background build once it finishes. get() rethrows if the build failed, which is fatal only for the first build: a
+	// failed reload keeps drawing with the pipeline it was meant to replace
+	if (_pendingPipeline.valid() && _pendingPipeline.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		try {
+			Pipeline rebuilt = _pendingPipeline.get();
+			// Earlier frames in flight may still use the old pipeline, the renderer frees it once they have finished
+			for (Pipeline& pipeline : _pipelines) {
+				_renderer.retirePipeline(std::move(pipeline));
+			}
+			_pipelines.clear();
+			_pipelines.push_back(std::move(rebuilt));
+			_renderer.shaderLibrary().trim(); // Drops the modules of the replaced shaders
+		}
+		catch (const std::exception& e) {
+			if (_pipelines.empty()) throw;
+			Logger::getLogger().print(std::string("Particle pipeline reload failed: ") + e.what());
+		}
+	}
+	// The placeholder while the pipeline compiles is an empty frame: the target is still cleared and the GUI drawn
+	if (_pipelines.empty()) return;
+
+	// The particle info changes from frame to frame (the GUI edits it), so this frame's copy goes to the upload heap
+	GlobalParticleInfo particleInfo = _particleSystem.particleInfo();
+	particleInfo.numParticles = _particleCount;
+	std::array<uint32_t, 2> constantOffsets{ _globalsOffset, _renderer.uploadHeap().push(particleInfo) };
 
-	// Bind pipelines and draw here
+	// Bind pipelines and draw here. The renderer has bound the bindless table, the draw only needs to say where its buffers are
 	for (auto& pipeline : _pipelines) {
 		vkCmdBindPipeline(cmd.buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline());
-		vkCmdBindDescriptorSets(cmd.buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipelineLayout(), 0, static_cast<uint32_t>(_particleSet.size()), _particleSet.data(), 0, nullptr);
+		_renderer.uploadHeap().bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipelineLayout(), 1, constantOffsets);
+		vkCmdPushConstants(cmd.buffer(), pipeline.pipelineLayout(), BindlessTable::stages, 0, sizeof(ParticleDrawIndices), &_drawIndices);
 	}
-	vkCmdDraw(cmd.buffer(), 6*_particleSystem.particleInfo().numParticles, 1, 0, 0);
+	vkCmdDraw(cmd.buffer(), 6*_particleCount, 1, 0, 0);
 }
\ No newline at end of file
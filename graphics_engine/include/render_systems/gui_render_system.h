@@ -9,6 +9,7 @@ public:
 	~GuiRenderSystem();
 
 	void render(Command& cmd);
+	const char* name() const override { return "ImGui"; }
 
 	void getNewFrame();
 
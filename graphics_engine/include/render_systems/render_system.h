@@ -10,6 +10,13 @@ public:
 	RenderSystem(Renderer& renderer) : _renderer(renderer) {}
 	virtual void render(Command& cmd) = 0;
 
+	// @brief Name the render system's GPU time is reported under
+	virtual const char* name() const { return "Render System"; }
+
+	// @brief Whether the system needs the frame rendered into an offscreen image before it reaches the swapchain, e.g. to sample it
+	//		  or write it from a compute shader. While no added system needs it, the renderer draws straight into the swapchain image
+	virtual bool requiresOffscreenTarget() const { return false; }
+
 protected:
 	Renderer& _renderer;
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "NonCopyable.h"
+#include "command.h"
+#include <vector>
+
+class Image;
+
+// @brief One side of a barrier: the pipeline stages that must finish (or wait), and the memory accesses of those stages that must
+//		  be made available (or visible). Only the stages and accesses that actually touch the resource should be named, anything
+//		  broader (e.g. ALL_COMMANDS) stalls work the barrier doesn't need to wait for
+struct BarrierScope {
+	VkPipelineStageFlags2 stages;
+	VkAccessFlags2 access;
+};
+
+// Scopes of the common uses of images and buffers
+namespace BarrierScopes {
+	// Nothing to wait for, e.g. the source of a transition out of UNDEFINED whose previous contents are discarded
+	inline constexpr BarrierScope none{ VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE };
+	inline constexpr BarrierScope colorAttachmentWrite{ VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT };
+	inline constexpr BarrierScope colorAttachmentReadWrite{ VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT };
+	inline constexpr BarrierScope fragmentSampledRead{ VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT };
+	inline constexpr BarrierScope computeStorageRead{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT };
+	inline constexpr BarrierScope computeStorageWrite{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT };
+	inline constexpr BarrierScope vertexStorageRead{ VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT };
+	inline constexpr BarrierScope transferRead{ VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT };
+	inline constexpr BarrierScope transferWrite{ VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT };
+	inline constexpr BarrierScope hostWrite{ VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_WRITE_BIT };
+	// Presentation is ordered by the render semaphore, which is signaled after every command of the submission. Nothing to wait on
+	inline constexpr BarrierScope present{ VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE };
+}
+
+// @brief Gathers image, buffer and global memory barriers and records them with a single vkCmdPipelineBarrier2, so the driver sees
+//		  every dependency between two groups of work at once instead of draining the pipeline once per barrier
+class BarrierBatch : public NonCopyable {
+public:
+	BarrierBatch() = default;
+
+	// @brief Adds a barrier on image, changing its layout to newLayout (or keeping it, if it is already in it). The old layout is read
+	//		  from the image and the image's layout is updated right away, so an image must only appear once per batch
+	//
+	// @param src - What used the image before the barrier
+	// @param dst - What will use it after the barrier
+	// @param aspect - Aspects of the image the barrier covers
+	// @return The batch, to chain barriers
+	BarrierBatch& image(Image& image, VkImageLayout newLayout, BarrierScope src, BarrierScope dst, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+	// @brief Adds a barrier on the range [offset, offset + size) of buffer
+	BarrierBatch& buffer(VkBuffer buffer, BarrierScope src, BarrierScope dst, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+	// @brief Adds a barrier on all memory. Cheaper to write than many buffer barriers, and most drivers treat them the same
+	BarrierBatch& memory(BarrierScope src, BarrierScope dst);
+
+	// @brief Records every barrier added so far into cmd with one vkCmdPipelineBarrier2 and clears the batch. Records nothing if it is empty
+	//
+	// @return The number of barriers recorded
+	uint32_t record(Command& cmd);
+
+	inline bool empty() const { return _imageBarriers.empty() && _bufferBarriers.empty() && _memoryBarriers.empty(); }
+	inline size_t size() const { return _imageBarriers.size() + _bufferBarriers.size() + _memoryBarriers.size(); }
+
+private:
+	std::vector<VkImageMemoryBarrier2> _imageBarriers;
+	std::vector<VkBufferMemoryBarrier2> _bufferBarriers;
+	std::vector<VkMemoryBarrier2> _memoryBarriers;
+};
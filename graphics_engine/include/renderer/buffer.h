@@ -37,6 +37,8 @@ public:
 	inline uint32_t instanceCount() const { return _instanceCount; }
 	inline size_t instanceSize() const { return _instanceSize; }
 	inline size_t alignmentSize() const { return _alignmentSize; }
+	// @brief CPU pointer to the buffer's memory, nullptr while unmapped
+	inline void* mappedData() const { return _mappedData; }
 
 private:
 	const Device& _device;
@@ -4,11 +4,14 @@
 #include "device.h"
 #include "buffer.h"
 #include "image.h"
+#include "command.h"
+#include <array>
 #include <span>
 #include <unordered_map>
 #include <vector>
 #include <string>
 #include <deque>
+#include <mutex>
 
 // @brief Describes how many of each type of descriptor set to make room for in the descriptor pool.
 //		  Used in the initialization of the descriptor pool in the DescriptorAllocator.
@@ -17,6 +20,67 @@ struct PoolSizeRatio {
 	float ratio;
 };
 
+// @brief Counters of a DescriptorAllocator, for the GUI
+struct DescriptorAllocatorStatistics {
+	uint32_t pools; // Pools created, ready and full
+	uint32_t setsAllocated; // Sets allocated since the last reset
+	uint32_t poolsExhausted; // Times a pool ran out and the allocation moved on to the next one, since creation
+};
+
+// @brief Allocates descriptor sets from a chain of pools that grows on demand. When the current pool runs out, it is set aside and the
+//		  allocation is retried in the next one, which is created with twice the sets (up to maxSetsPerPool) and with pool size ratios
+//		  taken from the descriptors the sets allocated so far actually used. Sets aren't freed one by one: reset() returns every set at
+//		  once and keeps the pools, so an allocator that is reset every frame settles on pools that fit a frame, and allocating from a
+//		  reset pool is little more than a pointer bump in the driver
+class DescriptorAllocator : public NonCopyable {
+public:
+	static constexpr uint32_t maxSetsPerPool = 4096;
+	// @brief Starting point for allocators that don't know what they will hold
+	static constexpr std::array<PoolSizeRatio, 4> defaultRatios{ {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 }
+	} };
+
+	// @param initialSets - Sets the first pool has room for
+	// @param ratios - Descriptors of each type per set in the first pool, until the sets allocated show what is used
+	DescriptorAllocator(const Device& device, uint32_t initialSets = 16, std::span<const PoolSizeRatio> ratios = defaultRatios);
+	~DescriptorAllocator();
+
+	DescriptorAllocator(DescriptorAllocator&& other) noexcept;
+	DescriptorAllocator& operator=(DescriptorAllocator&& other) noexcept;
+
+	// @brief Allocates a descriptor set using layout, from a new pool if the current ones are full
+	//
+	// @param layout - Descriptor set layout to create the descriptor set with
+	// @param bindings - The layout's bindings, if known. New pools are sized after the bindings of the sets allocated so far
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout, std::span<const VkDescriptorSetLayoutBinding> bindings = {});
+
+	// @brief Returns every set allocated to the pools. The sets must no longer be in use by the GPU
+	void reset();
+
+	DescriptorAllocatorStatistics statistics() const;
+
+private:
+	const Device& _device;
+	std::vector<PoolSizeRatio> _ratios; // Ratios of the next pool
+	std::vector<VkDescriptorPool> _readyPools; // Pools that can still be allocated from, the last one is used first
+	std::vector<VkDescriptorPool> _fullPools; // Pools that ran out since the last reset
+	uint32_t _nextPoolSets;
+	uint32_t _setsAllocated;
+	uint32_t _poolsExhausted;
+	std::unordered_map<VkDescriptorType, uint64_t> _descriptorsUsed; // Descriptors of each type in the sets allocated with known bindings
+	uint64_t _trackedSets; // Sets allocated with known bindings
+
+	// @brief Creates the next pool, with the adapted ratios and twice the sets of the last one, and makes it the first ready pool
+	VkDescriptorPool growPool();
+	VkDescriptorPool createPool(uint32_t maxSets);
+	// @brief Derives the next pool's ratios from the descriptors used per set so far
+	void adaptRatios();
+	void cleanup();
+};
+
 class DescriptorPool : public NonCopyable {
 public:
 	DescriptorPool(const Device& device, uint32_t maxSets, std::span<PoolSizeRatio> poolSizeRatios);
@@ -37,9 +101,48 @@ private:
 	VkDescriptorPool _descriptorPool;
 };
 
+// @brief Owns the engine's descriptor set layouts, one per distinct set of bindings. Requesting bindings that were requested before,
+//		  in any order, returns the same handle, so identical layouts cost nothing and pipelines using them have compatible layouts.
+//		  The layouts live as long as the cache. Thread safe
+class DescriptorLayoutCache : public NonCopyable {
+public:
+	DescriptorLayoutCache(const Device& device);
+	~DescriptorLayoutCache();
+
+	// @brief Returns the layout with these bindings, creating it on first request
+	//
+	// @param bindings - The layout's bindings, in any order
+	// @param flags - Layout create flags
+	// @param bindingFlags - Flags of each binding, in the order of bindings. Empty for none
+	VkDescriptorSetLayout get(std::span<const VkDescriptorSetLayoutBinding> bindings, VkDescriptorSetLayoutCreateFlags flags = 0,
+		std::span<const VkDescriptorBindingFlags> bindingFlags = {});
+
+	// @brief Bindings a layout of this cache was created with, sorted by binding. Empty for a layout created elsewhere
+	std::span<const VkDescriptorSetLayoutBinding> bindings(VkDescriptorSetLayout layout) const;
+
+	size_t size() const;
+
+private:
+	struct LayoutDescription {
+		VkDescriptorSetLayoutCreateFlags flags;
+		std::vector<VkDescriptorSetLayoutBinding> bindings; // Sorted by binding
+		std::vector<VkDescriptorBindingFlags> bindingFlags; // Empty, or one per binding
+		bool operator==(const LayoutDescription& other) const;
+	};
+	struct LayoutDescriptionHash {
+		size_t operator()(const LayoutDescription& description) const;
+	};
+
+	const Device& _device;
+	mutable std::mutex _mutex;
+	std::unordered_map<LayoutDescription, VkDescriptorSetLayout, LayoutDescriptionHash> _layouts;
+	std::unordered_map<VkDescriptorSetLayout, const LayoutDescription*> _descriptions; // Points into _layouts' keys, which never move
+};
+
 class DescriptorLayoutBuilder : public NonCopyable {
 public:
-	DescriptorLayoutBuilder(const Device& device);
+	// @param cache - Cache the built layouts come from
+	DescriptorLayoutBuilder(DescriptorLayoutCache& cache);
 
 	// @brief Adds a binding and descriptor type to the descriptor layout builder
 	// 
@@ -52,11 +155,15 @@ public:
 	// @brief Clears the builder of current bindings
 	DescriptorLayoutBuilder& clear();
 
-	// @brief Builds a descriptor set layout with the current bindings
+	// @brief Returns the descriptor set layout with the current bindings. It is owned by the cache, and shared with every other build
+	//		  of the same bindings
 	VkDescriptorSetLayout build();
 
+	// @brief The current bindings, e.g. for DescriptorAllocator::allocate() to size its pools after
+	inline std::span<const VkDescriptorSetLayoutBinding> bindings() const { return _bindings; }
+
 private:
-	const Device& _device;
+	DescriptorLayoutCache& _cache;
 
 	std::vector<VkDescriptorSetLayoutBinding> _bindings;
 };
@@ -87,5 +194,72 @@ private:
 
 };
 
+// @brief The engine's global descriptor table. A single set holds every storage buffer and sampled image in arrays, which shaders index
+//		  with indices passed as push constants. Registering a resource writes one array element, it needs no new layout, pool or set,
+//		  and the set is bound once per render system rather than per draw. The bindings are update-after-bind and partially bound,
+//		  so slots can be written while the set is bound and only the slots a draw reads need to hold a resource
+class PipelineLayoutCache;
+
+class BindlessTable : public NonCopyable {
+public:
+	static constexpr uint32_t storageBufferBinding = 0;
+	static constexpr uint32_t sampledImageBinding = 1;
+	static constexpr uint32_t maxStorageBuffers = 4096;
+	static constexpr uint32_t maxSampledImages = 4096;
+	static constexpr uint32_t pushConstantSize = 128; // The smallest maxPushConstantsSize a device may have
+	static constexpr VkShaderStageFlags stages = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+
+	// @param layoutCache - Cache the table's set layout comes from
+	// @param pipelineLayoutCache - Cache the layout the table is bound with comes from, the same one compatible pipelines get
+	BindlessTable(const Device& device, DescriptorLayoutCache& layoutCache, PipelineLayoutCache& pipelineLayoutCache);
+	~BindlessTable();
+
+	// @brief Writes buffer into a free storage buffer slot
+	// 
+	// @return The slot's index, for the shaders
+	uint32_t addStorageBuffer(Buffer& buffer);
+	// @brief Points the slot at index to buffer, e.g. after the buffer was reallocated. Frames still in flight must not read the slot
+	void writeStorageBuffer(uint32_t index, Buffer& buffer);
+	// @brief Frees the slot at index for another buffer, once no frame in flight reads it
+	void releaseStorageBuffer(uint32_t index);
+
+	// @brief Writes image, in its current layout, and sampler into a free sampled image slot
+	// 
+	// @return The slot's index, for the shaders
+	uint32_t addSampledImage(AllocatedImage& image, VkSampler sampler);
+	void writeSampledImage(uint32_t index, AllocatedImage& image, VkSampler sampler);
+	void releaseSampledImage(uint32_t index);
+
+	// @brief Binds the table as set 0 of bindPoint. Pipelines built with layout() and pushConstantRange() are compatible with it
+	void bind(Command& cmd, VkPipelineBindPoint bindPoint) const;
+
+	inline VkDescriptorSetLayout layout() const { return _layout; }
+	inline VkPushConstantRange pushConstantRange() const { return VkPushConstantRange{ stages, 0, pushConstantSize }; }
+
+	// @brief Whether physicalDevice supports the descriptor indexing features the table needs
+	static bool supported(VkPhysicalDevice physicalDevice);
+
+private:
+	// @brief Free list of the slots of one binding
+	struct Slots {
+		uint32_t capacity;
+		uint32_t used; // Slots below used have been handed out at least once
+		std::vector<uint32_t> released;
+
+		uint32_t acquire(const char* binding);
+		void release(uint32_t index);
+	};
+
+	const Device& _device;
+	VkDescriptorSetLayout _layout; // Owned by the layout cache
+	VkPipelineLayout _pipelineLayout; // Owned by the pipeline layout cache
+	VkDescriptorPool _pool;
+	VkDescriptorSet _set;
+	Slots _storageBuffers;
+	Slots _sampledImages;
+
+	void write(uint32_t binding, uint32_t index, VkDescriptorType descriptorType, const VkDescriptorBufferInfo* bufferInfo, const VkDescriptorImageInfo* imageInfo);
+};
+
 
 
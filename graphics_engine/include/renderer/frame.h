@@ -4,6 +4,8 @@
 #include "device.h"
 #include "command.h"
 #include "sync.h"
+#include "gpu_timer.h"
+#include "descriptor.h"
 
 class Command;
 
@@ -18,6 +20,9 @@ public:
 	inline Semaphore& renderSemaphore() { return _renderSemaphore; }
 	inline Fence& renderFence() { return _renderFence; }
 	inline Command& command() { return _command; }
+	inline GpuTimer& gpuTimer() { return _gpuTimer; }
+	// @brief Descriptor sets that only live for this frame. Reset by the renderer once the frame's fence has been waited on
+	inline DescriptorAllocator& transientDescriptors() { return _transientDescriptors; }
 
 private:
 	const Device& _device;
@@ -25,4 +30,6 @@ private:
 	Semaphore _renderSemaphore;
 	Fence _renderFence;
 	Command _command;
+	GpuTimer _gpuTimer;
+	DescriptorAllocator _transientDescriptors;
 };
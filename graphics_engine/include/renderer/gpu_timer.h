@@ -0,0 +1,54 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "NonCopyable.h"
+#include "device.h"
+#include <string>
+#include <vector>
+
+class Command;
+
+// @brief GPU duration of one timed section of a frame
+struct GpuZoneTiming {
+	const char* name;
+	double milliseconds;
+};
+
+// @brief Times sections of a command buffer with timestamp queries. Each frame in flight owns one, so the queries it wrote are read
+//		  back the next time the frame comes around, after its fence has been waited on. Results are never waited for: the
+//		  readback has one frame (in flight) of latency and never stalls the CPU
+class GpuTimer : public NonCopyable {
+public:
+	static constexpr uint32_t maxZones = 32;
+
+	GpuTimer(const Device& device);
+	~GpuTimer();
+
+	GpuTimer(GpuTimer&& other) noexcept;
+	GpuTimer& operator=(GpuTimer&& other) noexcept;
+
+	// @brief Reads back the zones written the last time this frame was recorded, then resets the queries. Must be called after the
+	//		  frame's fence was waited on, and recorded before the first zone (outside of any rendering)
+	void begin(Command& cmd);
+
+	// @brief Writes the starting timestamp of a zone
+	//
+	// @return Index of the zone, to be passed to endZone. maxZones if the timer is full (or timestamps aren't supported)
+	uint32_t beginZone(Command& cmd, const char* name);
+	void endZone(Command& cmd, uint32_t zone);
+
+	// @brief Zones of the most recently completed use of this timer
+	inline const std::vector<GpuZoneTiming>& results() const { return _results; }
+	inline bool supported() const { return _supported; }
+
+	void cleanup();
+
+private:
+	const Device& _device;
+	VkQueryPool _queryPool;
+	bool _supported; // Whether the graphics queue can write timestamps
+	float _timestampPeriod; // Nanoseconds per timestamp tick
+	uint64_t _timestampMask; // Only the valid bits of the timestamps are meaningful
+
+	std::vector<const char*> _zoneNames; // Zones written since the last begin()
+	std::vector<GpuZoneTiming> _results;
+};
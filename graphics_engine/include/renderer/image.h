@@ -3,6 +3,7 @@
 #include "vma/vk_mem_alloc.h"
 #include "utility/allocator.h"
 #include "command.h"
+#include "barrier.h"
 #include "NonCopyable.h"
 
 // Base image class 
@@ -19,11 +20,20 @@ public:
 	inline virtual VkExtent3D extent() const { return _extent; }
 	inline virtual VkFormat format() const { return _format; }
 
-	// @brief Transitions image from currentLayout to newLayout
+	// @brief Records a layout change made by a barrier recorded elsewhere (e.g. by a render graph), so later transitions start from it
+	inline void setImageLayout(VkImageLayout layout) { _imageLayout = layout; }
+
+	// @brief Transitions the image from its current layout to newLayout, waiting only for src and blocking only dst
+	//
+	// @param cmd - Command buffer to submit the barrier to (The barrier performs the transition)
+	// @param newLayout - Desired image layout to transition to
+	// @param src - Stages and accesses that used the image before the transition
+	// @param dst - Stages and accesses that will use the image in newLayout
+	void transitionImage(Command& cmd, VkImageLayout newLayout, BarrierScope src, BarrierScope dst);
+	// @brief Transitions the image from its current layout to newLayout, deducing both scopes from the layouts (e.g. a transfer
+	//		  source layout is used by transfer reads). Use the explicit overload, or a BarrierBatch, when the uses are known
 	//
 	// @param cmd - Command buffer to submit the barrier to (The barrier performs the transition)
-	// @param image - The image to transition
-	// @param currentLayout - Current image layout
 	// @param newLayout - Desired image layout to transition to
 	void transitionImage(Command& cmd, VkImageLayout newLayout);
 
@@ -2,11 +2,15 @@
 #include "vulkan/vulkan.h"
 #include "NonCopyable.h"
 #include "device.h"
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 class Pipeline : public NonCopyable {
 public:
 	Pipeline();
-	Pipeline(const Device* device, VkPipeline pipeline, VkPipelineLayout pipelineLayout);
+	// @param ownsLayout - Whether the pipeline destroys pipelineLayout. False for shared layouts, e.g. from the PipelineLayoutCache
+	Pipeline(const Device* device, VkPipeline pipeline, VkPipelineLayout pipelineLayout, bool ownsLayout = true);
 	~Pipeline();
 
 	// Write move constructors for the pipeline builder to function properly
@@ -15,12 +19,14 @@ public:
 
 	inline const VkPipeline pipeline() const { return _pipeline; }
 	inline const VkPipelineLayout pipelineLayout() const { return _pipelineLayout; }
+	inline bool ownsLayout() const { return _ownsLayout; }
 
 private:
 	// @brief The Vulkan render pipeline object
 	VkPipeline _pipeline;
 	// @brief The pipeline layout used for interacting with the pipeline
 	VkPipelineLayout _pipelineLayout;
+	bool _ownsLayout;
 
 	// @brief Reference to the Vulkan device used to create the pipeline
 	const Device* _device;
@@ -37,4 +43,33 @@ public:
 	// Creates a pipeline layout using the given create info
 	static VkPipelineLayout createPipelineLayout(const Device& device, VkPipelineLayoutCreateInfo createInfo);
 
+};
+
+// @brief Owns the engine's pipeline layouts, one per combination of descriptor set layouts and push constant ranges. Pipelines built
+//		  with the same sets and push constants share a layout, so switching between them keeps the bound sets and push constants.
+//		  Set layouts are compared by handle, which the DescriptorLayoutCache makes the same as comparing their bindings. Thread safe
+class PipelineLayoutCache : public NonCopyable {
+public:
+	PipelineLayoutCache(const Device& device);
+	// @brief Destroys every layout. The pipelines using them must be destroyed first
+	~PipelineLayoutCache();
+
+	// @brief Returns the layout with these set layouts and push constant ranges, creating it on first request
+	VkPipelineLayout get(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges = {});
+
+	size_t size() const;
+
+private:
+	struct LayoutKey {
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		std::vector<VkPushConstantRange> pushConstantRanges;
+		bool operator==(const LayoutKey& other) const;
+	};
+	struct LayoutKeyHash {
+		size_t operator()(const LayoutKey& key) const;
+	};
+
+	const Device& _device;
+	mutable std::mutex _mutex;
+	std::unordered_map<LayoutKey, VkPipelineLayout, LayoutKeyHash> _layouts;
 };
\ No newline at end of file
@@ -4,6 +4,9 @@
 #include "device.h"
 #include "shader.h"
 #include "pipeline.h"
+#include "pipeline_cache.h"
+#include <future>
+#include <memory>
 #include <vector>
 #include <stdexcept>
 
@@ -12,6 +15,7 @@ class Pipeline;
 struct PipelineConfig {
 	// Shaders
 	std::vector<VkPipelineShaderStageCreateInfo> shaderModules;
+	std::vector<std::shared_ptr<Shader>> heldShaders; // Keeps library shaders alive until the pipeline is built, even in the background
 
 	// Pipeline State
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{ .sType=VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
@@ -29,7 +33,9 @@ struct PipelineConfig {
 
 class PipelineBuilder : public NonCopyable {
 public:
-	PipelineBuilder(const Device& device);
+	// @param pipelineCache - Cache every pipeline is created with, so later launches skip compiling them
+	// @param layoutCache - Cache the pipeline layouts come from. Built pipelines share their layout and don't destroy it
+	PipelineBuilder(const Device& device, const PipelineCache& pipelineCache, PipelineLayoutCache& layoutCache);
 
 	// @brief Resets the PipelineBuilder to its default state
 	void clear();
@@ -37,12 +43,16 @@ public:
 	// @brief Build a Pipeline with the current chosen parameters of the PipelineBuilder
 	// TODO: possibly move this to the Pipeline class so that each type of pipeline can adjust how they're built?
 	Pipeline buildPipeline();
+	// @brief Builds a Pipeline with a copy of the current parameters on another thread. The builder can be cleared and reused right
+	//		  away. Shaders added by reference must outlive the build, shaders added from the library are held by the copy
+	std::future<Pipeline> buildPipelineAsync();
 
 	PipelineBuilder& setConfig(PipelineConfig config);
 	inline PipelineConfig config() const { return _config; }
 
 	// Shaders
 	PipelineBuilder& setShader(Shader& shader);
+	PipelineBuilder& setShader(std::shared_ptr<Shader> shader);
 
 	// Pipeline State
 	PipelineBuilder& setInputTopology(VkPrimitiveTopology topology);
@@ -64,5 +74,10 @@ public:
 private:
 	// @brief Reference to the Vulkan device which creates the pipelines
 	const Device& _device;
+	const PipelineCache& _pipelineCache;
+	PipelineLayoutCache& _layoutCache;
 	PipelineConfig _config;
+
+	// @brief Builds a pipeline from config. Only reads the builder's device and caches, so builds can run on several threads
+	Pipeline build(PipelineConfig config) const;
 };
\ No newline at end of file
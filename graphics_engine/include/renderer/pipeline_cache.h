@@ -0,0 +1,41 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "NonCopyable.h"
+#include <string>
+
+class Device;
+
+// @brief A VkPipelineCache persisted between runs. The driver keeps the compiled form of every pipeline created with the cache, so
+//		  pipelines built on a later launch skip compiling their SPIR-V. The file is named after the vendor, device and pipeline cache
+//		  UUID (which changes with the driver), and its header is checked against the device before it is handed to the driver: a
+//		  cache from another GPU or driver version is ignored and replaced when the cache is saved
+class PipelineCache : public NonCopyable {
+public:
+	// @brief Creates the cache, seeded with the file of this device and driver in directory if there is a valid one
+	//
+	// @param device - Device the pipelines are created on
+	// @param directory - Directory of the cache files. Empty for the working directory
+	PipelineCache(const Device& device, const std::string& directory = "");
+	// @brief Saves the cache, then destroys it
+	~PipelineCache();
+
+	inline VkPipelineCache handle() const { return _cache; }
+	inline const std::string& path() const { return _path; }
+	// @brief Whether a valid cache file was loaded, i.e. whether this launch starts warm
+	inline bool loadedFromDisk() const { return _loadedSize > 0; }
+	inline size_t loadedSize() const { return _loadedSize; }
+
+	// @brief Writes the cache's contents to its file, unless nothing was added since it was loaded or last saved. The file is
+	//		  written next to its final path and renamed over it, so an interrupted save never leaves a truncated cache behind
+	void save();
+
+private:
+	const Device& _device;
+	VkPipelineCache _cache;
+	std::string _path;
+	size_t _loadedSize; // Bytes of cache data loaded from the file, 0 when starting cold
+	size_t _savedSize; // Size of the data at the last load or save, to skip saving an unchanged cache
+
+	// @brief Whether data starts with a pipeline cache header matching this device and driver
+	bool validHeader(const std::byte* data, size_t size) const;
+};
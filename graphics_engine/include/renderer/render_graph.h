@@ -0,0 +1,193 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "NonCopyable.h"
+#include "image.h"
+#include "command.h"
+#include "barrier.h"
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+class Device;
+class Allocator;
+
+// @brief How a pass uses a resource. Each usage implies the pipeline stages and access of the use and, for images, the layout
+enum class ResourceUsage {
+	colorAttachment, // Written as the color attachment of the pass's rendering
+	sampled, // Read through a sampler by fragment shaders
+	storageRead, // Read as a storage image or buffer by compute shaders
+	storageWrite, // Written (and possibly read) as a storage image or buffer by compute shaders
+	vertexShaderRead, // Read as a storage buffer (or sampled image) by vertex shaders
+	transferSrc,
+	transferDst,
+	present // Only valid as the final usage of an output, the image is handed to the presentation engine after the graph
+};
+
+// @brief Index of a resource in the graph it was declared in. Only valid until the graph is reset
+using RenderGraphResource = uint32_t;
+
+// @brief Description of an image the graph allocates itself. Transient images only live within a frame, so images with
+//		  the same description whose lifetimes don't overlap share one allocation
+struct TransientImageDescription {
+	VkExtent3D extent;
+	VkFormat format;
+};
+
+// @brief Counters of the last compiled graph
+struct RenderGraphStatistics {
+	uint32_t passes; // Declared passes
+	uint32_t culledPasses; // Passes dropped because nothing reads what they write
+	uint32_t barriers; // Image and buffer barriers recorded
+	uint32_t barrierBatches; // vkCmdPipelineBarrier2 calls the barriers were recorded in
+	uint32_t transientImages; // Transient images used by the kept passes
+	uint32_t physicalImages; // Allocations backing them
+};
+
+class RenderGraph;
+
+// @brief One pass of a frame. Passes declare every resource they use, the graph then orders the barriers between them
+class RenderGraphPass {
+public:
+	// @brief Declares a read of resource. Reading a resource keeps the passes that wrote it
+	RenderGraphPass& read(RenderGraphResource resource, ResourceUsage usage);
+	// @brief Declares a write of resource. A pass only runs if a kept pass reads what it writes, it writes an output or it has side effects
+	RenderGraphPass& write(RenderGraphResource resource, ResourceUsage usage);
+	// @brief Renders into resource: the graph begins dynamic rendering on it around the execute callback. Without a clear value the
+	//		  previous contents are loaded, which makes the attachment a read too
+	RenderGraphPass& colorAttachment(RenderGraphResource resource, std::optional<VkClearValue> clear = std::nullopt);
+	// @brief Keeps the pass even if nothing reads what it writes (e.g. it writes to the host or to resources outside the graph)
+	RenderGraphPass& sideEffects();
+	// @brief The commands of the pass. Called while the graph records, after the pass's barriers
+	RenderGraphPass& execute(std::function<void(Command&)> callback);
+
+	inline const std::string& name() const { return _name; }
+
+private:
+	friend class RenderGraph;
+
+	struct Access {
+		RenderGraphResource resource;
+		ResourceUsage usage;
+		bool write;
+	};
+
+	RenderGraphPass(std::string name) : _name(std::move(name)) {}
+
+	std::string _name;
+	std::vector<Access> _accesses;
+	std::optional<RenderGraphResource> _colorAttachment;
+	std::optional<VkClearValue> _clear;
+	bool _sideEffects{ false };
+	bool _culled{ false };
+	std::function<void(Command&)> _execute;
+};
+
+// @brief A small frame graph. Every frame the renderer resets the graph, imports the images and buffers it doesn't own, declares its
+//		  passes and what they read and write, then compiles and executes it. Compiling drops the passes whose results are never used
+//		  and assigns the transient images to allocations; executing records, before each pass, one batch with only the barriers its
+//		  accesses need (a layout change, or a hazard with an earlier access), with the stages and accesses of both sides
+class RenderGraph : public NonCopyable {
+public:
+	RenderGraph(const Device& device, const Allocator& allocator);
+	~RenderGraph() = default;
+
+	// @brief Forgets the passes and resources of the last frame. The transient allocations are kept for the next frames
+	void reset();
+
+	// @brief Adds an image the graph doesn't own. Its layout is read from the image and written back as the graph records
+	//
+	// @param initialStage - Stages that last used the image before the graph, e.g. the stage the acquire semaphore is waited on for a swapchain image
+	// @param initialAccess - Writes of those stages that must be made visible
+	RenderGraphResource importImage(const std::string& name, Image& image,
+		VkPipelineStageFlags2 initialStage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VkAccessFlags2 initialAccess = VK_ACCESS_2_MEMORY_WRITE_BIT);
+	// @brief Adds a buffer the graph doesn't own
+	RenderGraphResource importBuffer(const std::string& name, VkBuffer buffer,
+		VkPipelineStageFlags2 initialStage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VkAccessFlags2 initialAccess = VK_ACCESS_2_MEMORY_WRITE_BIT);
+	// @brief Declares an image that only lives within the frame. It is allocated (or aliased) when the graph compiles, if a kept pass uses it
+	RenderGraphResource createImage(const std::string& name, const TransientImageDescription& description);
+
+	// @brief Marks resource as a result of the frame: the passes writing it are kept, and it ends the graph in finalUsage's layout
+	void setOutput(RenderGraphResource resource, ResourceUsage finalUsage);
+
+	// @brief Adds a pass. Passes run in the order they are added
+	RenderGraphPass& addPass(const std::string& name);
+
+	// @brief Culls the unused passes and assigns the transient images. Must be called before execute()
+	void compile();
+	// @brief Records the kept passes and their barriers into cmd
+	void execute(Command& cmd);
+
+	// @brief The image behind a resource. For transient images only valid after compile()
+	Image& image(RenderGraphResource resource);
+
+	inline const RenderGraphStatistics& statistics() const { return _statistics; }
+
+private:
+	// @brief Synchronization state of a resource: what has used it since the last write, and what the last write has been made visible to
+	struct ResourceState {
+		VkImageLayout layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkPipelineStageFlags2 writeStages{ VK_PIPELINE_STAGE_2_NONE };
+		VkAccessFlags2 writeAccess{ VK_ACCESS_2_NONE };
+		VkPipelineStageFlags2 readStages{ VK_PIPELINE_STAGE_2_NONE }; // Stages that read since the last write
+		VkPipelineStageFlags2 visibleStages{ VK_PIPELINE_STAGE_2_NONE }; // Stages the last write is visible to
+		VkAccessFlags2 visibleAccess{ VK_ACCESS_2_NONE };
+	};
+
+	// @brief Stages, access and layout of one pass's use of a resource, merged over all its declared accesses of the resource
+	struct UsageInfo {
+		VkPipelineStageFlags2 stage;
+		VkAccessFlags2 access;
+		VkAccessFlags2 writeAccess; // The writing part of access
+		VkImageLayout layout;
+		VkImageUsageFlags imageUsage; // Usage flags an image needs to be used this way
+		bool write;
+	};
+
+	struct Resource {
+		std::string name;
+		bool isImage;
+		Image* image{ nullptr };
+		VkBuffer buffer{ VK_NULL_HANDLE };
+		bool transient{ false };
+		TransientImageDescription description{};
+		VkImageUsageFlags imageUsage{ 0 }; // Union of the usages of the kept passes, for allocating transient images
+		std::optional<ResourceUsage> finalUsage; // Set for outputs
+		int firstPass{ -1 }; // First and last kept pass using the resource
+		int lastPass{ -1 };
+		int physicalImage{ -1 };
+		ResourceState state;
+	};
+
+	// @brief An allocation backing transient images. It outlives the frame, so its state carries the last frame's accesses over
+	struct PhysicalImage {
+		std::unique_ptr<AllocatedImage> image;
+		TransientImageDescription description;
+		VkImageUsageFlags usage;
+		ResourceState state;
+		int availableAfter; // Last pass of the transient image currently assigned to it, this frame
+		uint32_t unusedFrames;
+	};
+
+	const Device& _device;
+	const Allocator& _allocator;
+
+	std::vector<Resource> _resources;
+	std::vector<std::unique_ptr<RenderGraphPass>> _passes; // Pointers, so the references addPass() returns stay valid
+	std::vector<PhysicalImage> _physicalImages;
+	bool _compiled{ false };
+	RenderGraphStatistics _statistics{};
+
+	BarrierBatch _barriers; // The barriers of the pass being recorded
+
+	void cullPasses();
+	void assignTransientImages();
+
+	static UsageInfo usageInfo(ResourceUsage usage, bool write);
+
+	// @brief Adds the barrier that makes resource ready for the use described by info, if any is needed, and updates its state
+	void transition(Resource& resource, const UsageInfo& info);
+	// @brief Records and clears the barriers gathered so far, in one call
+	void flushBarriers(Command& cmd);
+};
@@ -4,12 +4,17 @@
 #include "utility/allocator.h"
 #include "utility/debug_messenger.h"
 #include "shader.h"
+#include "shader_library.h"
+#include "shader_hot_reloader.h"
 #include "pipeline_builder.h"
 #include "swapchain.h"
 #include "image.h"
 #include "descriptor.h"
+#include "render_graph.h"
+#include "upload_heap.h"
 #include "render_systems/render_system.h"
 #include <string>
+#include <utility>
 
 class Swapchain;
 class AllocatedImage;
@@ -28,7 +33,8 @@ public:
 	// @brief Handles changes that need to be made when the window is resized
 	void resizeCallback();
 
-	// @brief Adds renderSystem to the end of the renderSystems list
+	// @brief Adds renderSystem to the end of the renderSystems list. The first system that requires an offscreen target switches the
+	//		  renderer from drawing straight into the swapchain image to drawing into _drawImage and copying it to the swapchain
 	// 
 	// @param renderSystem - render system to add to the Renderer's list
 	// @return Returns the Renderer handle in order to chain together adds
@@ -41,14 +47,33 @@ public:
 
 	void waitForIdle();
 
+	// @brief Takes a pipeline that was replaced, e.g. by a hot reload, and destroys it once no frame in flight can still be using it
+	void retirePipeline(Pipeline&& pipeline);
+
 	inline Device& device() { return _device; }
 	inline Swapchain& swapchain() { return _swapchain; }
 	inline Instance& instance() { return _instance; }
 	inline PipelineBuilder& pipelineBuilder() { return _pipelineBuilder; }
+	inline PipelineCache& pipelineCache() { return _pipelineCache; }
+	inline ShaderLibrary& shaderLibrary() { return _shaderLibrary; }
+	inline ShaderHotReloader& shaderHotReloader() { return _shaderHotReloader; }
+	inline BindlessTable& bindlessTable() { return _bindlessTable; }
 	inline DescriptorLayoutBuilder& descriptorLayoutBuilder() { return _descriptorLayoutBuilder; }
+	inline DescriptorLayoutCache& descriptorLayoutCache() { return _descriptorLayoutCache; }
+	inline PipelineLayoutCache& pipelineLayoutCache() { return _pipelineLayoutCache; }
 	inline DescriptorWriter& descriptorWriter() { return _descriptorWriter; }
+	// @brief Allocator for descriptor sets that live as long as the application
+	inline DescriptorAllocator& descriptorAllocator() { return _descriptorAllocator; }
+	// @brief Allocator for descriptor sets used by the frame being recorded only
+	inline DescriptorAllocator& frameDescriptors() { return getCurrentFrame().transientDescriptors(); }
+	// @brief Per-frame constants, valid for the frame being prepared or recorded
+	inline UploadHeap& uploadHeap() { return _uploadHeap; }
 	inline Allocator& allocator() { return _allocator; }
 	inline float aspectRatio() { return _aspectRatio; }
+	// @brief Whether frames are drawn into an offscreen image and copied to the swapchain, rather than drawn into the swapchain image
+	inline bool rendersOffscreen() const { return _rendersOffscreen; }
+	// @brief The graph the last frame was recorded with, e.g. for its statistics
+	inline const RenderGraph& renderGraph() const { return _renderGraph; }
 
 private:
 	Window& _window; // Window is created outside the renderer. This is a reference to it. A Renderer cannot exist without a window to render to, so it's not a pointer
@@ -57,14 +82,28 @@ private:
 	Device _device; // Device object containing physical and logical devices
 	Allocator _allocator; // Allocator for buffers and images
 	Swapchain _swapchain; // The swapchain handles presenting images to the surface and thus to the window
+	PipelineCache _pipelineCache; // Compiled pipelines, loaded from and saved to disk so later launches start faster
+	ShaderLibrary _shaderLibrary; // Shader modules shared by every render system
+	DescriptorLayoutCache _descriptorLayoutCache; // Every descriptor set layout, one per distinct set of bindings
+	PipelineLayoutCache _pipelineLayoutCache; // Every pipeline layout, one per distinct combination of set layouts and push constants
+	ShaderHotReloader _shaderHotReloader; // Recompiles changed shaders and notifies the render systems using them
+	BindlessTable _bindlessTable; // Every storage buffer and sampled image the shaders read, bound once per render system
 	PipelineBuilder _pipelineBuilder; // Pipeline builder object that abstracts and handles pipeline creation
 	std::vector<Frame> _frames; // Contains command buffers and sync objects for each frame in the swapchain
 	uint32_t _frameNumber; // Keeps track of the number of rendered frames
-	AllocatedImage _drawImage; // Image that gets rendered to then copied to the swapchain image
+	AllocatedImage _drawImage; // Image that gets rendered to then copied to the swapchain image. Only allocated when rendering offscreen
+	bool _rendersOffscreen; // Set once any render system requires an offscreen target
 	DescriptorLayoutBuilder _descriptorLayoutBuilder; // Builds descriptor set layouts
 	DescriptorWriter _descriptorWriter;
+	DescriptorAllocator _descriptorAllocator; // Long-lived descriptor sets, in pools that grow as needed
+	UploadHeap _uploadHeap; // Per-frame constants, bound through dynamic uniform buffer offsets
+	RenderGraph _renderGraph; // Declares the passes of each frame, then orders them and the barriers between them
+	std::vector<std::pair<uint32_t, Pipeline>> _retiredPipelines; // Replaced pipelines and the frame they were retired in
 
 	float _aspectRatio;
 
 	std::vector<RenderSystem*> _renderSystems;
+
+	// @brief Allocates _drawImage at the window's size
+	void createDrawImage();
 };
\ No newline at end of file
@@ -1,14 +1,21 @@
 #pragma once
 #include "vulkan/vulkan.h"
 #include "device.h"
+#include "NonCopyable.h"
 #include <string>
-#include <fstream>
 #include <sstream>
 #include <iostream>
 
-class Shader {
+class Shader : public NonCopyable {
 public:
+	// @brief Creates a shader module from the SPIR-V file at filepath. The file is memory mapped rather than read into a copy
 	Shader(const Device& device, const std::string& filepath, VkShaderStageFlagBits stageFlag);
+	// @brief Creates a shader module from SPIR-V already in memory
+	//
+	// @param code - The SPIR-V words
+	// @param codeSize - Size of code in bytes
+	// @param name - Name of the shader in error messages, e.g. its path
+	Shader(const Device& device, const uint32_t* code, size_t codeSize, VkShaderStageFlagBits stageFlag, const std::string& name);
 	~Shader();
 	
 	inline VkShaderModule module() const { return _shaderModule; }
@@ -24,4 +31,6 @@ private:
 	const Device& _device;
 	VkShaderModule _shaderModule;
 	VkShaderStageFlagBits _shaderStageFlag;
+
+	void createModule(const uint32_t* code, size_t codeSize, const std::string& name);
 };
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+#include "NonCopyable.h"
+#include "utility/file_watcher.h"
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+
+// @brief Rebuilds pipelines while the application runs when their shaders change on disk. A GLSL source (.vert, .frag, .comp) that is
+//		  saved is compiled to <source>.spv next to it on a background thread, the same way the compile_project_shaders CMake step does.
+//		  A SPIR-V file that changes, written by that compile or by any other tool, calls back every listener that uses it. Listeners
+//		  run on the thread calling update(), at the start of a frame, and are expected to rebuild in the background and swap their
+//		  pipelines in once the build finishes (see Renderer::retirePipeline for freeing the old ones)
+class ShaderHotReloader : public NonCopyable {
+public:
+	// @param compiler - glslangValidator executable. Defaults to the one CMake found, or the one on the PATH
+	ShaderHotReloader(const std::string& compiler = defaultCompiler());
+	// @brief Waits for the compiles still running
+	~ShaderHotReloader();
+
+	// @brief Starts watching the shaders in directory
+	void watch(const std::string& directory);
+
+	// @brief Registers callback to be called when any of spirvPaths changes
+	//
+	// @return Id to pass to removeListener() before whatever the callback refers to is destroyed
+	uint32_t addListener(const std::vector<std::string>& spirvPaths, std::function<void()> callback);
+	void removeListener(uint32_t id);
+
+	// @brief Starts compiling the GLSL sources saved since the last call, logs the compiles that finished, and calls the listeners of
+	//		  the SPIR-V files that changed. Called once per frame
+	void update();
+
+	inline bool watching() const { return _watcher.watching(); }
+
+	static std::string defaultCompiler();
+
+private:
+	struct Listener {
+		uint32_t id;
+		std::vector<std::string> spirvPaths; // Normalized like the watcher's paths
+		std::function<void()> callback;
+	};
+	struct Compile {
+		std::string source;
+		std::future<int> exitCode;
+		bool sourceChangedAgain; // Saved again while compiling, compile once more when this one finishes
+	};
+
+	std::string _compiler;
+	FileWatcher _watcher;
+	std::vector<Listener> _listeners;
+	std::vector<Compile> _compiles;
+	uint32_t _nextListenerId;
+
+	void compile(const std::string& source);
+	static bool isGlslSource(const std::string& path);
+};
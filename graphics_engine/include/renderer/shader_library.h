@@ -0,0 +1,58 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "NonCopyable.h"
+#include "shader.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class Device;
+
+// @brief Counters of the shader library, for the GUI
+struct ShaderLibraryStatistics {
+	uint32_t requests; // Calls to load()
+	uint32_t modulesCreated; // Requests that created a new module
+	uint32_t modules; // Modules currently held
+};
+
+// @brief Owns the engine's shader modules. Shaders are loaded by path, but kept by the hash of their SPIR-V, so two render systems (or
+//		  two rebuilds of one pipeline) asking for the same code share a single module, and a file whose contents changed gets a new
+//		  one. Files are memory mapped, nothing is copied before Vulkan reads the code. Thread safe, so pipelines can be built in the background
+class ShaderLibrary : public NonCopyable {
+public:
+	ShaderLibrary(const Device& device);
+
+	// @brief Returns the module of the SPIR-V file at path, creating it if no loaded shader has the same code and stage
+	std::shared_ptr<Shader> load(const std::string& path, VkShaderStageFlagBits stage);
+
+	// @brief Content hash the file at path had when it was last loaded, 0 if it never was
+	uint64_t loadedHash(const std::string& path) const;
+
+	// @brief Destroys the modules nothing else holds anymore. Pipelines don't need their modules once created, so this can run after any build
+	void trim();
+
+	ShaderLibraryStatistics statistics() const;
+
+	// @brief 64-bit FNV-1a hash of size bytes at data
+	static uint64_t contentHash(const void* data, size_t size);
+
+private:
+	struct ShaderKey {
+		uint64_t hash;
+		VkShaderStageFlagBits stage;
+		bool operator==(const ShaderKey& other) const { return hash == other.hash && stage == other.stage; }
+	};
+	struct ShaderKeyHash {
+		size_t operator()(const ShaderKey& key) const { return static_cast<size_t>(key.hash ^ (static_cast<uint64_t>(key.stage) << 1)); }
+	};
+
+	const Device& _device;
+
+	mutable std::mutex _mutex;
+	std::unordered_map<ShaderKey, std::shared_ptr<Shader>, ShaderKeyHash> _shaders;
+	std::unordered_map<std::string, uint64_t> _pathHashes; // Hash of each path's contents when it was last loaded
+	uint32_t _requests;
+	uint32_t _modulesCreated;
+};
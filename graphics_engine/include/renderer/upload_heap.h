@@ -0,0 +1,77 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "NonCopyable.h"
+#include "buffer.h"
+#include "command.h"
+#include <cstring>
+#include <memory>
+#include <span>
+
+class Device;
+class Allocator;
+class DescriptorLayoutCache;
+class DescriptorAllocator;
+
+// @brief Where an UploadHeap allocation is: the CPU pointer to write through, and the dynamic offset to bind it with
+struct UploadAllocation {
+	void* data;
+	uint32_t offset;
+};
+
+// @brief Linear allocator for per-frame constants. One persistently mapped uniform buffer is split into a region per frame, and each
+//		  allocation just bumps the offset in the current frame's region, aligned to minUniformBufferOffsetAlignment. The buffer is
+//		  reached through one descriptor set of UNIFORM_BUFFER_DYNAMIC bindings that all view the whole buffer, so the set never changes:
+//		  a draw binds it with the dynamic offsets of its allocations. There is one region more than frames in flight, so constants can
+//		  be pushed before the renderer waits for the frame's fence: the frame that last used the region had finished by the time the
+//		  previous frame started recording
+class UploadHeap : public NonCopyable {
+public:
+	static constexpr uint32_t dynamicBindings = 4; // Allocations a single bind can reach, as bindings 0 to dynamicBindings - 1
+	static constexpr size_t defaultBytesPerFrame = 256 * 1024;
+
+	// @param layoutCache - Cache the heap's set layout comes from
+	// @param descriptorAllocator - Allocator the heap's set is allocated from, once
+	// @param framesInFlight - Frames that can be in flight at once
+	// @param bytesPerFrame - Bytes that can be allocated between two nextFrame() calls
+	UploadHeap(const Device& device, const Allocator& allocator, DescriptorLayoutCache& layoutCache, DescriptorAllocator& descriptorAllocator,
+		uint32_t framesInFlight, size_t bytesPerFrame = defaultBytesPerFrame);
+
+	// @brief Allocates size bytes in the current frame's region. Throws if the region is full or size is larger than a binding can view
+	UploadAllocation allocate(size_t size);
+
+	// @brief Copies value into the current frame's region
+	//
+	// @return The dynamic offset of the copy
+	template<typename T>
+	uint32_t push(const T& value) {
+		UploadAllocation allocation = allocate(sizeof(T));
+		std::memcpy(allocation.data, &value, sizeof(T));
+		return allocation.offset;
+	}
+
+	// @brief Moves to the next frame's region, dropping everything allocated in it before. Called by the renderer after each frame
+	void nextFrame();
+
+	// @brief Binds the heap's set, binding i at offsets[i]. Bindings without an offset are bound at 0
+	//
+	// @param layout - Pipeline layout with the heap's set layout at set
+	void bind(Command& cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set, std::span<const uint32_t> offsets) const;
+
+	inline VkDescriptorSetLayout layout() const { return _layout; }
+	// @brief Largest allocation a binding can view, the range of the dynamic descriptors
+	inline size_t maxAllocationSize() const { return _range; }
+	// @brief Bytes allocated in the current frame's region, including alignment padding
+	inline size_t usedThisFrame() const { return _offset - _regionStart; }
+
+private:
+	std::unique_ptr<Buffer> _buffer;
+	VkDescriptorSetLayout _layout; // Owned by the layout cache
+	VkDescriptorSet _set;
+	size_t _alignment;
+	size_t _range;
+	size_t _bytesPerFrame;
+	uint32_t _regions;
+	uint32_t _region; // Region of the frame being prepared
+	size_t _regionStart;
+	size_t _offset; // Next free byte of the current region
+};
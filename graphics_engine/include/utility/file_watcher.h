@@ -0,0 +1,43 @@
+#pragma once
+#include "NonCopyable.h"
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// @brief Reports files written in a set of watched directories. On Linux the kernel queues the changes (inotify), so checking
+//		  costs a single non-blocking read. Elsewhere, or if inotify is unavailable, the directories are scanned for newer
+//		  modification times at most every pollInterval. Paths are returned lexically normalized, see normalize()
+class FileWatcher : public NonCopyable {
+public:
+	static constexpr std::chrono::milliseconds pollInterval{ 500 };
+
+	FileWatcher();
+	~FileWatcher();
+
+	// @brief Starts watching the files directly inside directory. Throws if it doesn't exist
+	void watchDirectory(const std::string& directory);
+
+	// @brief Files created, written or moved into a watched directory since the last call, each reported once
+	std::vector<std::string> changedFiles();
+
+	inline bool watching() const { return !_directories.empty(); }
+
+	// @brief The form paths are reported in, so callers can compare their own paths against changedFiles()
+	static std::string normalize(const std::filesystem::path& path);
+
+private:
+	struct WatchedDirectory {
+		std::filesystem::path path;
+		int watch; // inotify watch descriptor, -1 if the directory is polled
+		std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes; // Polled directories only
+	};
+
+	std::vector<WatchedDirectory> _directories;
+	int _inotify; // inotify instance, -1 when polling
+	std::chrono::steady_clock::time_point _lastPoll;
+
+	void readEvents(std::vector<std::string>& changed);
+	void pollDirectory(WatchedDirectory& directory, std::vector<std::string>& changed);
+};
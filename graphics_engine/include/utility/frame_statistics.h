@@ -0,0 +1,106 @@
+#pragma once
+#include "NonCopyable.h"
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// @brief Parts of a frame measured separately from the whole frame time
+enum class FramePhase {
+	cpuSim, // Simulation update on the CPU
+	cpuRecord, // Recording the frame's command buffer
+	fenceWait, // Waiting for the GPU to finish the frame that last used this frame's resources
+	present, // Queue present call
+	count
+};
+
+// @brief Frame pacing statistics: rolling percentiles over the last windowSize frames, plus a frame time histogram and an over-budget
+//		  count accumulated since the last reset. Owned by the Timer, which closes a frame on every update()
+class FrameStatistics : public NonCopyable {
+public:
+	static constexpr int windowSize = 1000;
+	static constexpr int phaseCount = static_cast<int>(FramePhase::count);
+	static constexpr int histogramBins = 50; // The last bin also counts every frame longer than the histogram range
+
+	FrameStatistics();
+
+	// @brief Adds to the time spent in phase during the current frame. A phase can be recorded several times per frame
+	void recordPhase(FramePhase phase, double milliseconds);
+
+	// @brief Closes the current frame with its total duration
+	void endFrame(double frameMilliseconds);
+
+	// @brief Clears the window, the histogram and the over-budget count
+	void reset();
+
+	// @brief Frame time percentile (0-100) over the rolling window, in milliseconds
+	double percentile(double p) const;
+	double phasePercentile(FramePhase phase, double p) const;
+	double phaseMean(FramePhase phase) const;
+
+	void setBudget(double milliseconds) { _budgetMilliseconds = milliseconds; }
+	inline double budget() const { return _budgetMilliseconds; }
+	inline uint64_t overBudgetFrames() const { return _overBudgetFrames; }
+	inline uint64_t totalFrames() const { return _totalFrames; }
+	inline int samples() const { return _samples; }
+
+	inline double histogramBinWidth() const { return _histogramBinWidth; }
+	inline const std::array<uint64_t, histogramBins>& histogram() const { return _histogram; }
+
+	// @brief Writes one row per frame of the rolling window (frame time and every phase) to a CSV file
+	//
+	// @return False if the file couldn't be written
+	bool exportCsv(const std::string& path) const;
+
+	// @brief Adds the frame statistics window to the Gui
+	void addWidgets();
+
+	static const char* phaseName(FramePhase phase);
+
+private:
+	struct FrameSample {
+		uint64_t frame;
+		double frameMilliseconds;
+		std::array<double, phaseCount> phaseMilliseconds;
+	};
+
+	std::vector<FrameSample> _window; // Ring buffer of the last windowSize frames
+	int _next;
+	int _samples;
+	std::array<double, phaseCount> _currentPhases; // Phases recorded for the frame in progress
+
+	std::array<uint64_t, histogramBins> _histogram;
+	double _histogramBinWidth; // Milliseconds per bin
+	double _budgetMilliseconds;
+	uint64_t _overBudgetFrames;
+	uint64_t _totalFrames;
+	std::string _exportStatus; // Outcome of the last CSV export, shown by the widget
+
+	// @brief Percentile of the values selected by value over the window
+	template<typename Selector>
+	double windowPercentile(double p, Selector value) const;
+};
+
+// @brief Records the time between its construction and destruction as a frame phase
+class FramePhaseTimer {
+public:
+	FramePhaseTimer(FrameStatistics& statistics, FramePhase phase) :
+		_statistics(statistics), _phase(phase), _start(std::chrono::steady_clock::now()), _active(true) {}
+	~FramePhaseTimer() { end(); }
+
+	// @brief Ends the phase before the end of its scope. Does nothing if the phase already ended
+	void end() {
+		if (!_active) return;
+		_active = false;
+		_statistics.recordPhase(_phase, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count());
+	}
+
+	FramePhaseTimer(const FramePhaseTimer&) = delete;
+	FramePhaseTimer& operator=(const FramePhaseTimer&) = delete;
+
+private:
+	FrameStatistics& _statistics;
+	FramePhase _phase;
+	std::chrono::steady_clock::time_point _start;
+	bool _active;
+};
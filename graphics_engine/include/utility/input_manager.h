@@ -11,7 +11,8 @@ enum class InputEvent {
 	leftMouseDown, leftMouseUp,
 	rightMouseDown, rightMouseUp,
 	spacebarDown, spacebarUp,
-	rightArrowDown, rightArrowUp
+	rightArrowDown, rightArrowUp,
+	f9Down, f9Up
 };
 
 class InputManager : public NonCopyable {
@@ -0,0 +1,33 @@
+#pragma once
+#include "NonCopyable.h"
+#include <cstddef>
+#include <string>
+
+// @brief Read-only memory mapping of a whole file. The contents are paged in by the OS on first access, so opening even a large file
+//		  is cheap and nothing is copied until the data is read
+class MappedFile : public NonCopyable {
+public:
+	// @brief Maps the file at path. Throws if it can't be opened or mapped
+	MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	inline const std::byte* data() const { return _data; }
+	inline size_t size() const { return _size; }
+	inline const std::string& path() const { return _path; }
+
+private:
+	std::string _path;
+	const std::byte* _data;
+	size_t _size;
+#ifdef _WIN32
+	void* _file;
+	void* _mapping;
+#else
+	int _file;
+#endif
+
+	void cleanup();
+};
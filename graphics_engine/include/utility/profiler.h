@@ -0,0 +1,203 @@
+#pragma once
+#include "NonCopyable.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Scoped CPU profiling zones. Define ENGINE_DISABLE_PROFILING to compile every zone out
+#ifndef ENGINE_DISABLE_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// @brief Times the enclosing scope. name must be a string literal (or otherwise outlive the profiler)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(_profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+// @brief Records a point in time (e.g. a queue submission) on the calling thread
+#define PROFILE_MARKER(name) Profiler::getProfiler().marker(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_MARKER(name)
+#endif
+
+// @brief One completed zone, or a marker when instant is set. Times are nanoseconds since the profiler was created
+struct ProfileEvent {
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+	uint32_t depth; // Number of zones open on the same thread when this one started
+	bool instant;
+};
+
+// @brief A completed zone and the lane (thread slot) it was recorded on
+struct ProfileRecord {
+	ProfileEvent event;
+	uint32_t lane;
+};
+
+// @brief Fixed size single-producer single-consumer ring of events. The owning thread pushes, the profiler drains on the main thread.
+//		  Neither side locks; when the ring is full new events are dropped rather than blocking the producer. When its thread exits the
+//		  buffer is handed to the next new thread, so short-lived workers (like std::async tasks) reuse a small set of buffers ("lanes")
+class ProfileEventBuffer : public NonCopyable {
+public:
+	static constexpr uint32_t capacity = 1 << 14; // Must be a power of two
+
+	ProfileEventBuffer(uint32_t lane) : _lane(lane), _events{} {}
+
+	// @brief Called only by the owning thread
+	inline void push(const ProfileEvent& event) {
+		uint64_t head = _head.load(std::memory_order_relaxed);
+		if (head - _tail.load(std::memory_order_acquire) >= capacity) {
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		_events[head & (capacity - 1)] = event;
+		_head.store(head + 1, std::memory_order_release);
+	}
+
+	// @brief Called only by the profiler. Appends every event pushed so far to records
+	void drain(std::vector<ProfileRecord>& records);
+
+	inline uint32_t lane() const { return _lane; }
+	inline uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+	friend class Profiler;
+
+	uint32_t _lane;
+	std::array<ProfileEvent, capacity> _events;
+	std::atomic<uint64_t> _head{ 0 }; // Next slot the producer writes
+	std::atomic<uint64_t> _tail{ 0 }; // Next slot the consumer reads
+	std::atomic<uint64_t> _dropped{ 0 };
+};
+
+// @brief Rolling statistics of one zone name, over the per-frame totals of the last historySize frames
+struct ZoneStatistics {
+	static constexpr int historySize = 120;
+
+	std::array<double, historySize> history{}; // Milliseconds spent in the zone per frame, summed over every thread
+	int samples = 0;
+	int next = 0;
+	uint32_t calls = 0; // Calls in the last frame
+
+	void add(double milliseconds);
+	double last() const;
+	double mean() const;
+	double max() const;
+};
+
+// @brief Collects the zones recorded by every thread. Zones are recorded without locks into a buffer owned by their thread, and
+//		  collected once per frame by newFrame() on the main thread, which keeps the last frame for the flame view and updates the
+//		  rolling statistics of each zone
+class Profiler : public NonCopyable {
+public:
+	// @brief Get the static instance of the profiler
+	static Profiler& getProfiler() {
+		static Profiler instance;
+		return instance;
+	}
+
+	// @brief To be called once per frame, on the main thread. Collects the zones completed since the last call as the previous frame
+	void newFrame();
+
+	// @brief Adds the profiler window (flame graph and zone statistics) to the Gui. Call every frame, like the other widgets
+	void addWidgets();
+
+	void setEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+	inline bool enabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+	// @brief Names the calling thread's lane in the profiler views
+	void setThreadName(const std::string& name);
+
+	// @brief Records an instant event on the calling thread
+	void marker(const char* name);
+
+	// @brief Adds a GPU duration (e.g. from GpuTimer) to the statistics of the current frame, as zone "GPU <name>". Main thread only
+	void recordGpuTime(const char* name, double milliseconds);
+
+	// @brief Records every zone and marker of the next numFrames frames, then writes them to path as a Chrome trace-event JSON file
+	//		  (loadable in Perfetto or chrome://tracing). Does nothing if a capture is already running
+	void startCapture(int numFrames, const std::string& path);
+	inline bool capturing() const { return _captureFramesLeft > 0; }
+	inline const std::string& lastCapturePath() const { return _lastCapturePath; }
+
+	// @brief Nanoseconds since the profiler was created
+	inline uint64_t now() const {
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _epoch).count());
+	}
+
+	// @brief The calling thread's event buffer. The first call on a thread registers it (or reuses the buffer of a finished thread)
+	ProfileEventBuffer& threadBuffer();
+
+	inline const std::vector<ProfileRecord>& lastFrame() const { return _lastFrame; }
+	inline uint64_t lastFrameStart() const { return _lastFrameStart; }
+	inline uint64_t lastFrameEnd() const { return _lastFrameEnd; }
+	inline uint64_t frameNumber() const { return _frameNumber; }
+	inline const std::unordered_map<std::string, ZoneStatistics>& statistics() const { return _statistics; }
+	std::string laneName(uint32_t lane);
+	uint64_t droppedEvents();
+
+private:
+	Profiler();
+
+	friend struct ProfileThreadSlot;
+	void releaseBuffer(ProfileEventBuffer* buffer);
+
+	std::chrono::steady_clock::time_point _epoch;
+	std::atomic<bool> _enabled{ true };
+
+	std::mutex _registryMutex; // Only taken when a thread registers or exits, never while recording
+	std::vector<std::unique_ptr<ProfileEventBuffer>> _buffers;
+	std::vector<ProfileEventBuffer*> _freeBuffers; // Buffers of finished threads, ready for the next new thread
+	std::vector<std::string> _laneNames;
+
+	uint64_t _frameNumber{ 0 };
+	uint64_t _currentFrameStart{ 0 };
+	uint64_t _lastFrameStart{ 0 };
+	uint64_t _lastFrameEnd{ 0 };
+	std::vector<ProfileRecord> _collected; // Scratch for the events drained this frame
+	std::vector<ProfileRecord> _lastFrame;
+	std::vector<std::pair<const char*, double>> _gpuTimes; // GPU durations reported this frame
+	std::unordered_map<std::string, ZoneStatistics> _statistics;
+	bool _freezeView{ false }; // Keeps the flame graph on one frame so it can be inspected
+
+	// Capture
+	struct CapturedFrame {
+		uint64_t number;
+		uint64_t start;
+		uint64_t end;
+	};
+	int _captureFramesLeft{ 0 };
+	std::string _capturePath;
+	std::string _lastCapturePath;
+	std::vector<ProfileRecord> _captureRecords;
+	std::vector<CapturedFrame> _captureFrames;
+	int _captureFrameCount{ 30 }; // Frames captured by the GUI button
+
+	// @brief Writes the captured records as Chrome trace events and clears the capture
+	void writeCapture();
+};
+
+// @brief Records the time between its construction and destruction as a zone on the calling thread
+class ProfileZone {
+public:
+	ProfileZone(const char* name);
+	~ProfileZone();
+
+	// @brief Ends the zone before the end of its scope. Does nothing if the zone already ended
+	void end();
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+	const char* _name;
+	uint64_t _start;
+	uint32_t _depth;
+	bool _active;
+};
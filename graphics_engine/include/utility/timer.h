@@ -2,11 +2,14 @@
 #include <chrono>
 #include <cmath>
 #include "NonCopyable.h"
+#include "utility/frame_statistics.h"
 
 class Timer : public NonCopyable {
 public:
-	// @brief To be called every frame. Updates the frametime and avg fps counter
-	void update();
+	// @brief To be called every frame. Updates the frametime and avg fps counter, and closes the frame in the frame statistics
+	//
+	// @param countFrame False to keep this frame out of the frame statistics (e.g. while rendering is paused)
+	void update(bool countFrame = true);
 
 	// @brief Get the static instance of the timer
 	static Timer& getTimer() {
@@ -16,12 +19,14 @@ public:
 
 	inline float frameTime() const { return _frameTime; }
 	inline float framesPerSecond() const { return _fps; }
+	inline FrameStatistics& statistics() { return _statistics; }
 
 private:
 	Timer();
 
 	float _frameTime;
 	float _fps;
+	FrameStatistics _statistics;
 
 	std::chrono::steady_clock::time_point _currentTime;
 	std::chrono::steady_clock::time_point _newTime;
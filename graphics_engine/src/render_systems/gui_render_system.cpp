@@ -40,6 +40,7 @@ GuiRenderSystem::GuiRenderSystem(Renderer& renderer, Window& window) :
 		.MinImageCount = _renderer.swapchain().framesInFlight(),
 		.ImageCount = _renderer.swapchain().framesInFlight(),
 		.MSAASamples = VK_SAMPLE_COUNT_1_BIT,
+		.PipelineCache = _renderer.pipelineCache().handle(),
 		.UseDynamicRendering = true,
 		.PipelineRenderingCreateInfo = pipelineRenderingInfo
 	};
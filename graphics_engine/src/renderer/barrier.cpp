@@ -0,0 +1,78 @@
+#include "renderer/barrier.h"
+#include "renderer/image.h"
+
+BarrierBatch& BarrierBatch::image(Image& image, VkImageLayout newLayout, BarrierScope src, BarrierScope dst, VkImageAspectFlags aspect) {
+	_imageBarriers.push_back(VkImageMemoryBarrier2{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+		.pNext = nullptr,
+		.srcStageMask = src.stages,
+		.srcAccessMask = src.access,
+		.dstStageMask = dst.stages,
+		.dstAccessMask = dst.access,
+		.oldLayout = image.imageLayout(),
+		.newLayout = newLayout,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image.image(),
+		.subresourceRange = VkImageSubresourceRange{
+			.aspectMask = aspect,
+			.baseMipLevel = 0,
+			.levelCount = VK_REMAINING_MIP_LEVELS,
+			.baseArrayLayer = 0,
+			.layerCount = VK_REMAINING_ARRAY_LAYERS
+		}
+	});
+	image.setImageLayout(newLayout);
+	return *this;
+}
+
+BarrierBatch& BarrierBatch::buffer(VkBuffer buffer, BarrierScope src, BarrierScope dst, VkDeviceSize offset, VkDeviceSize size) {
+	_bufferBarriers.push_back(VkBufferMemoryBarrier2{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+		.pNext = nullptr,
+		.srcStageMask = src.stages,
+		.srcAccessMask = src.access,
+		.dstStageMask = dst.stages,
+		.dstAccessMask = dst.access,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.buffer = buffer,
+		.offset = offset,
+		.size = size
+	});
+	return *this;
+}
+
+BarrierBatch& BarrierBatch::memory(BarrierScope src, BarrierScope dst) {
+	_memoryBarriers.push_back(VkMemoryBarrier2{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.pNext = nullptr,
+		.srcStageMask = src.stages,
+		.srcAccessMask = src.access,
+		.dstStageMask = dst.stages,
+		.dstAccessMask = dst.access
+	});
+	return *this;
+}
+
+uint32_t BarrierBatch::record(Command& cmd) {
+	if (empty()) return 0;
+
+	VkDependencyInfo dependencyInfo{
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.pNext = nullptr,
+		.memoryBarrierCount = static_cast<uint32_t>(_memoryBarriers.size()),
+		.pMemoryBarriers = _memoryBarriers.data(),
+		.bufferMemoryBarrierCount = static_cast<uint32_t>(_bufferBarriers.size()),
+		.pBufferMemoryBarriers = _bufferBarriers.data(),
+		.imageMemoryBarrierCount = static_cast<uint32_t>(_imageBarriers.size()),
+		.pImageMemoryBarriers = _imageBarriers.data()
+	};
+	vkCmdPipelineBarrier2(cmd.buffer(), &dependencyInfo);
+
+	uint32_t count = static_cast<uint32_t>(size());
+	_imageBarriers.clear();
+	_bufferBarriers.clear();
+	_memoryBarriers.clear();
+	return count;
+}
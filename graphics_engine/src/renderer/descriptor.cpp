@@ -1,4 +1,7 @@
 #include "renderer/descriptor.h"
+#include "renderer/pipeline.h"
+#include <algorithm>
+#include <array>
 
 // ---------------------------------------------- DESCRIPTOR POOL -----------------------------------------------------------------
 
@@ -45,9 +48,166 @@ VkDescriptorSet DescriptorPool::allocateDescriptorSet(VkDescriptorSetLayout layo
 	return set;
 }
 
+// ---------------------------------------------- DESCRIPTOR ALLOCATOR -----------------------------------------------------------------
+
+DescriptorAllocator::DescriptorAllocator(const Device& device, uint32_t initialSets, std::span<const PoolSizeRatio> ratios) :
+	_device(device),
+	_ratios(ratios.begin(), ratios.end()),
+	_nextPoolSets(std::max(initialSets, 1u)),
+	_setsAllocated(0),
+	_poolsExhausted(0),
+	_trackedSets(0) {}
+
+DescriptorAllocator::~DescriptorAllocator() {
+	cleanup();
+}
+
+DescriptorAllocator::DescriptorAllocator(DescriptorAllocator&& other) noexcept :
+	_device(other._device),
+	_ratios(std::move(other._ratios)),
+	_readyPools(std::move(other._readyPools)),
+	_fullPools(std::move(other._fullPools)),
+	_nextPoolSets(other._nextPoolSets),
+	_setsAllocated(other._setsAllocated),
+	_poolsExhausted(other._poolsExhausted),
+	_descriptorsUsed(std::move(other._descriptorsUsed)),
+	_trackedSets(other._trackedSets) {
+	other._readyPools.clear();
+	other._fullPools.clear();
+}
+
+DescriptorAllocator& DescriptorAllocator::operator=(DescriptorAllocator&& other) noexcept {
+	if (this != &other) {
+		cleanup();
+		_ratios = std::move(other._ratios);
+		_readyPools = std::move(other._readyPools);
+		_fullPools = std::move(other._fullPools);
+		_nextPoolSets = other._nextPoolSets;
+		_setsAllocated = other._setsAllocated;
+		_poolsExhausted = other._poolsExhausted;
+		_descriptorsUsed = std::move(other._descriptorsUsed);
+		_trackedSets = other._trackedSets;
+		other._readyPools.clear();
+		other._fullPools.clear();
+	}
+	return *this;
+}
+
+void DescriptorAllocator::cleanup() {
+	for (VkDescriptorPool pool : _readyPools) {
+		vkDestroyDescriptorPool(_device.device(), pool, nullptr);
+	}
+	for (VkDescriptorPool pool : _fullPools) {
+		vkDestroyDescriptorPool(_device.device(), pool, nullptr);
+	}
+	_readyPools.clear();
+	_fullPools.clear();
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t maxSets) {
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (PoolSizeRatio ratio : _ratios) {
+		poolSizes.emplace_back(ratio.type, std::max(static_cast<uint32_t>(ratio.ratio * maxSets), 1u));
+	}
+	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0, // Sets are only returned by resetting the whole pool
+		.maxSets = maxSets,
+		.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+		.pPoolSizes = poolSizes.data()
+	};
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(_device.device(), &descriptorPoolCreateInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor pool!");
+	}
+	return pool;
+}
+
+void DescriptorAllocator::adaptRatios() {
+	if (_trackedSets == 0) return;
+	// Types the tracked sets never used keep their ratio, sets allocated without their bindings may still need them
+	for (const auto& [type, count] : _descriptorsUsed) {
+		float observed = static_cast<float>(count) / static_cast<float>(_trackedSets);
+		auto ratio = std::find_if(_ratios.begin(), _ratios.end(), [type](const PoolSizeRatio& ratio) { return ratio.type == type; });
+		if (ratio != _ratios.end()) {
+			ratio->ratio = observed;
+		}
+		else {
+			_ratios.push_back(PoolSizeRatio{ type, observed });
+		}
+	}
+}
+
+VkDescriptorPool DescriptorAllocator::growPool() {
+	adaptRatios();
+	_readyPools.push_back(createPool(_nextPoolSets));
+	_nextPoolSets = std::min(_nextPoolSets * 2, maxSetsPerPool);
+	return _readyPools.back();
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout, std::span<const VkDescriptorSetLayoutBinding> bindings) {
+	if (!bindings.empty()) {
+		for (const VkDescriptorSetLayoutBinding& binding : bindings) {
+			_descriptorsUsed[binding.descriptorType] += binding.descriptorCount;
+		}
+		_trackedSets++;
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.pNext = nullptr,
+		.descriptorPool = VK_NULL_HANDLE,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &layout
+	};
+	VkDescriptorSet set = VK_NULL_HANDLE;
+
+	// A pool can run out of one descriptor type while others still have room, and pools from before a reset can be smaller or miss a
+	// type the ratios only gained later, so every ready pool is tried before growing. Each one that is full is set aside until the next reset
+	while (!_readyPools.empty()) {
+		allocInfo.descriptorPool = _readyPools.back();
+		VkResult result = vkAllocateDescriptorSets(_device.device(), &allocInfo, &set);
+		if (result == VK_SUCCESS) {
+			_setsAllocated++;
+			return set;
+		}
+		if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+			throw std::runtime_error("Failed to allocate descriptor sets!");
+		}
+		_fullPools.push_back(_readyPools.back());
+		_readyPools.pop_back();
+		_poolsExhausted++;
+	}
+
+	// Only a new pool, sized with the latest ratios, failing as well means the set can't be allocated
+	allocInfo.descriptorPool = growPool();
+	if (vkAllocateDescriptorSets(_device.device(), &allocInfo, &set) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate descriptor sets!");
+	}
+	_setsAllocated++;
+	return set;
+}
+
+void DescriptorAllocator::reset() {
+	for (VkDescriptorPool pool : _readyPools) {
+		vkResetDescriptorPool(_device.device(), pool, 0);
+	}
+	for (VkDescriptorPool pool : _fullPools) {
+		vkResetDescriptorPool(_device.device(), pool, 0);
+		_readyPools.push_back(pool);
+	}
+	_fullPools.clear();
+	_setsAllocated = 0;
+}
+
+DescriptorAllocatorStatistics DescriptorAllocator::statistics() const {
+	return DescriptorAllocatorStatistics{ static_cast<uint32_t>(_readyPools.size() + _fullPools.size()), _setsAllocated, _poolsExhausted };
+}
+
 // ---------------------------------------------- DESCRIPTOR LAYOUT BUILDER -----------------------------------------------------------------
 
-DescriptorLayoutBuilder::DescriptorLayoutBuilder(const Device& device) : _device(device) {}
+DescriptorLayoutBuilder::DescriptorLayoutBuilder(DescriptorLayoutCache& cache) : _cache(cache) {}
 
 DescriptorLayoutBuilder& DescriptorLayoutBuilder::addBinding(uint32_t binding, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags) {
 	VkDescriptorSetLayoutBinding newBinding{
@@ -66,20 +226,103 @@ DescriptorLayoutBuilder& DescriptorLayoutBuilder::clear() {
 }
 
 VkDescriptorSetLayout DescriptorLayoutBuilder::build() {
+	return _cache.get(_bindings);
+}
+
+// ---------------------------------------------- DESCRIPTOR LAYOUT CACHE -----------------------------------------------------------------
+
+DescriptorLayoutCache::DescriptorLayoutCache(const Device& device) : _device(device) {}
+
+DescriptorLayoutCache::~DescriptorLayoutCache() {
+	for (const auto& [description, layout] : _layouts) {
+		vkDestroyDescriptorSetLayout(_device.device(), layout, nullptr);
+	}
+}
+
+bool DescriptorLayoutCache::LayoutDescription::operator==(const LayoutDescription& other) const {
+	if (flags != other.flags || bindingFlags != other.bindingFlags || bindings.size() != other.bindings.size()) return false;
+	for (size_t i = 0; i < bindings.size(); i++) {
+		const VkDescriptorSetLayoutBinding& a = bindings[i];
+		const VkDescriptorSetLayoutBinding& b = other.bindings[i];
+		if (a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount
+			|| a.stageFlags != b.stageFlags || a.pImmutableSamplers != b.pImmutableSamplers) return false;
+	}
+	return true;
+}
+
+size_t DescriptorLayoutCache::LayoutDescriptionHash::operator()(const LayoutDescription& description) const {
+	size_t hash = description.flags;
+	auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2); };
+	for (const VkDescriptorSetLayoutBinding& binding : description.bindings) {
+		combine(binding.binding);
+		combine(binding.descriptorType);
+		combine(binding.descriptorCount);
+		combine(binding.stageFlags);
+	}
+	for (VkDescriptorBindingFlags flags : description.bindingFlags) {
+		combine(flags);
+	}
+	return hash;
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::get(std::span<const VkDescriptorSetLayoutBinding> bindings, VkDescriptorSetLayoutCreateFlags flags,
+	std::span<const VkDescriptorBindingFlags> bindingFlags) {
+	if (!bindingFlags.empty() && bindingFlags.size() != bindings.size()) {
+		throw std::runtime_error("Descriptor set layout needs one binding flag per binding!");
+	}
+
+	// Sort by binding so the order bindings were added in doesn't make two identical layouts different
+	std::vector<size_t> order(bindings.size());
+	for (size_t i = 0; i < order.size(); i++) order[i] = i;
+	std::sort(order.begin(), order.end(), [&bindings](size_t a, size_t b) { return bindings[a].binding < bindings[b].binding; });
+
+	LayoutDescription description{ flags, {}, {} };
+	for (size_t i : order) {
+		description.bindings.push_back(bindings[i]);
+		if (!bindingFlags.empty()) description.bindingFlags.push_back(bindingFlags[i]);
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto found = _layouts.find(description);
+	if (found != _layouts.end()) {
+		return found->second;
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+		.pNext = nullptr,
+		.bindingCount = static_cast<uint32_t>(description.bindingFlags.size()),
+		.pBindingFlags = description.bindingFlags.data()
+	};
 	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-		.pNext = nullptr,
-		.flags = 0,
-		.bindingCount = static_cast<uint32_t>(_bindings.size()),
-		.pBindings = _bindings.data()
+		.pNext = description.bindingFlags.empty() ? nullptr : &bindingFlagsInfo,
+		.flags = flags,
+		.bindingCount = static_cast<uint32_t>(description.bindings.size()),
+		.pBindings = description.bindings.data()
 	};
 	VkDescriptorSetLayout layout;
 	if (vkCreateDescriptorSetLayout(_device.device(), &descriptorSetLayoutCreateInfo, nullptr, &layout) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to build descriptor set layout!");
 	}
+
+	auto inserted = _layouts.emplace(std::move(description), layout).first;
+	_descriptions.emplace(layout, &inserted->first);
 	return layout;
 }
 
+std::span<const VkDescriptorSetLayoutBinding> DescriptorLayoutCache::bindings(VkDescriptorSetLayout layout) const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto found = _descriptions.find(layout);
+	if (found == _descriptions.end()) return {};
+	return found->second->bindings;
+}
+
+size_t DescriptorLayoutCache::size() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _layouts.size();
+}
+
 // ---------------------------------------------- DESCRIPTOR WRITER -----------------------------------------------------------------
 
 DescriptorWriter::DescriptorWriter(const Device& device) : _device(device) {}
@@ -139,4 +382,129 @@ DescriptorWriter& DescriptorWriter::clear() {
 	return *this;
 }
 
+// ---------------------------------------------- BINDLESS TABLE -----------------------------------------------------------------
+
+uint32_t BindlessTable::Slots::acquire(const char* binding) {
+	if (!released.empty()) {
+		uint32_t index = released.back();
+		released.pop_back();
+		return index;
+	}
+	if (used == capacity) {
+		throw std::runtime_error(std::string("Bindless table is out of ") + binding + " slots!");
+	}
+	return used++;
+}
+
+void BindlessTable::Slots::release(uint32_t index) {
+	released.push_back(index);
+}
+
+BindlessTable::BindlessTable(const Device& device, DescriptorLayoutCache& layoutCache, PipelineLayoutCache& pipelineLayoutCache) :
+	_device(device),
+	_layout(VK_NULL_HANDLE),
+	_pipelineLayout(VK_NULL_HANDLE),
+	_pool(VK_NULL_HANDLE),
+	_set(VK_NULL_HANDLE),
+	_storageBuffers{ maxStorageBuffers, 0, {} },
+	_sampledImages{ maxSampledImages, 0, {} } {
+
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings{
+		VkDescriptorSetLayoutBinding{ storageBufferBinding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxStorageBuffers, stages, nullptr },
+		VkDescriptorSetLayoutBinding{ sampledImageBinding, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxSampledImages, stages, nullptr }
+	};
+	// Update-after-bind lets slots be written while the set is bound, unused-while-pending while frames that don't read them are in flight
+	VkDescriptorBindingFlags flags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+	std::array<VkDescriptorBindingFlags, 2> bindingFlags{ flags, flags };
+	_layout = layoutCache.get(bindings, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT, bindingFlags);
+	_pipelineLayout = pipelineLayoutCache.get({ _layout }, { pushConstantRange() });
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes{
+		VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxStorageBuffers },
+		VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxSampledImages }
+	};
+	VkDescriptorPoolCreateInfo poolCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+		.maxSets = 1,
+		.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+		.pPoolSizes = poolSizes.data()
+	};
+	if (vkCreateDescriptorPool(_device.device(), &poolCreateInfo, nullptr, &_pool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create the bindless descriptor pool!");
+	}
 
+	VkDescriptorSetAllocateInfo allocInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.pNext = nullptr,
+		.descriptorPool = _pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &_layout
+	};
+	if (vkAllocateDescriptorSets(_device.device(), &allocInfo, &_set) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate the bindless descriptor set!");
+	}
+}
+
+BindlessTable::~BindlessTable() {
+	vkDestroyDescriptorPool(_device.device(), _pool, nullptr);
+}
+
+bool BindlessTable::supported(VkPhysicalDevice physicalDevice) {
+	VkPhysicalDeviceVulkan12Features features12{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+	VkPhysicalDeviceFeatures2 features{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &features12 };
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+	return features12.descriptorIndexing && features12.runtimeDescriptorArray && features12.descriptorBindingPartiallyBound
+		&& features12.descriptorBindingStorageBufferUpdateAfterBind && features12.descriptorBindingSampledImageUpdateAfterBind
+		&& features12.descriptorBindingUpdateUnusedWhilePending;
+}
+
+void BindlessTable::write(uint32_t binding, uint32_t index, VkDescriptorType descriptorType, const VkDescriptorBufferInfo* bufferInfo, const VkDescriptorImageInfo* imageInfo) {
+	VkWriteDescriptorSet write{
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.pNext = nullptr,
+		.dstSet = _set,
+		.dstBinding = binding,
+		.dstArrayElement = index,
+		.descriptorCount = 1,
+		.descriptorType = descriptorType,
+		.pImageInfo = imageInfo,
+		.pBufferInfo = bufferInfo
+	};
+	vkUpdateDescriptorSets(_device.device(), 1, &write, 0, nullptr);
+}
+
+uint32_t BindlessTable::addStorageBuffer(Buffer& buffer) {
+	uint32_t index = _storageBuffers.acquire("storage buffer");
+	writeStorageBuffer(index, buffer);
+	return index;
+}
+
+void BindlessTable::writeStorageBuffer(uint32_t index, Buffer& buffer) {
+	VkDescriptorBufferInfo bufferInfo{ .buffer = buffer.buffer(), .offset = 0, .range = VK_WHOLE_SIZE };
+	write(storageBufferBinding, index, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &bufferInfo, nullptr);
+}
+
+void BindlessTable::releaseStorageBuffer(uint32_t index) {
+	_storageBuffers.release(index);
+}
+
+uint32_t BindlessTable::addSampledImage(AllocatedImage& image, VkSampler sampler) {
+	uint32_t index = _sampledImages.acquire("sampled image");
+	writeSampledImage(index, image, sampler);
+	return index;
+}
+
+void BindlessTable::writeSampledImage(uint32_t index, AllocatedImage& image, VkSampler sampler) {
+	VkDescriptorImageInfo imageInfo{ .sampler = sampler, .imageView = image.imageView(), .imageLayout = image.imageLayout() };
+	write(sampledImageBinding, index, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &imageInfo);
+}
+
+void BindlessTable::releaseSampledImage(uint32_t index) {
+	_sampledImages.release(index);
+}
+
+void BindlessTable::bind(Command& cmd, VkPipelineBindPoint bindPoint) const {
+	vkCmdBindDescriptorSets(cmd.buffer(), bindPoint, _pipelineLayout, 0, 1, &_set, 0, nullptr);
+}
@@ -1,13 +1,24 @@
 #include "renderer/device.h"
+#include "renderer/descriptor.h"
 
-VkPhysicalDeviceFeatures Device::deviceFeatures{};
+// Shaders index the bindless table's arrays with push constants
+VkPhysicalDeviceFeatures Device::deviceFeatures{ .shaderSampledImageArrayDynamicIndexing = true,
+												 .shaderStorageBufferArrayDynamicIndexing = true };
 
 VkPhysicalDeviceVulkan13Features Device::features13{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
 													 .synchronization2 = true,
 													 .dynamicRendering = true };
 
+// The descriptor indexing features are the ones the BindlessTable needs
 VkPhysicalDeviceVulkan12Features Device::features12{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
 													 .descriptorIndexing = true,
+													 .shaderSampledImageArrayNonUniformIndexing = true,
+													 .shaderStorageBufferArrayNonUniformIndexing = true,
+													 .descriptorBindingSampledImageUpdateAfterBind = true,
+													 .descriptorBindingStorageBufferUpdateAfterBind = true,
+													 .descriptorBindingUpdateUnusedWhilePending = true,
+													 .descriptorBindingPartiallyBound = true,
+													 .runtimeDescriptorArray = true,
 													 .bufferDeviceAddress = true };
 
 Device::Device(const Instance& instance, Window& window, const std::vector<const char*>& extensions) : 
@@ -122,7 +133,7 @@ bool Device::isDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR surf
 	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
 	bool discreteGPU = deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
 
-	return indices.isComplete() && extensionsSupported && swapchainAdequate && discreteGPU;
+	return indices.isComplete() && extensionsSupported && swapchainAdequate && discreteGPU && BindlessTable::supported(physicalDevice);
 }
 
 VkPhysicalDevice Device::selectPhysicalDevice(VkInstance instance, VkSurfaceKHR surface, const std::vector<const char*>& requiredExtensions) {
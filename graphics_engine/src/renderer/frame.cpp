@@ -5,14 +5,18 @@ Frame::Frame(const Device& device) : _device(device),
 	_presentSemaphore(device),
 	_renderSemaphore(device), 
 	_renderFence(device, VK_FENCE_CREATE_SIGNALED_BIT),
-	_command(device, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT) {}
+	_command(device, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT),
+	_gpuTimer(device),
+	_transientDescriptors(device) {}
 
 
 Frame::Frame(Frame&& other) noexcept : _device(other._device),
 	_presentSemaphore(std::move(other._presentSemaphore)),
 	_renderSemaphore(std::move(other._renderSemaphore)),
 	_renderFence(std::move(other._renderFence)),
-	_command(std::move(other._command)) {}
+	_command(std::move(other._command)),
+	_gpuTimer(std::move(other._gpuTimer)),
+	_transientDescriptors(std::move(other._transientDescriptors)) {}
 
 Frame& Frame::operator=(Frame&& other) noexcept {
 	if (this != &other) {
@@ -20,6 +24,8 @@ Frame& Frame::operator=(Frame&& other) noexcept {
 		_renderSemaphore = std::move(other._renderSemaphore);
 		_renderFence = std::move(other._renderFence);
 		_command = std::move(other._command);
+		_gpuTimer = std::move(other._gpuTimer);
+		_transientDescriptors = std::move(other._transientDescriptors);
 	}
 	return *this;
 }
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "renderer/gpu_timer.h"
+#include "renderer/command.h"
+#include <stdexcept>
+
+GpuTimer::GpuTimer(const Device& device) :
+	_device(device),
+	_queryPool(VK_NULL_HANDLE),
+	_supported(false),
+	_timestampPeriod(device.physicalDeviceProperies().limits.timestampPeriod),
+	_timestampMask(0) {
+
+	QueueFamilyIndices indices = _device.queueFamilyIndices();
+	uint32_t validBits = indices.queueFamilyProperties[indices.graphicsFamily.value()].timestampValidBits;
+	_supported = validBits > 0;
+	_timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+	if (!_supported) return;
+
+	// Two queries per zone: the start and the end timestamp
+	VkQueryPoolCreateInfo queryPoolInfo{
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = 2 * maxZones
+	};
+	if (vkCreateQueryPool(_device.device(), &queryPoolInfo, nullptr, &_queryPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create timestamp query pool!");
+	}
+}
+
+GpuTimer::~GpuTimer() {
+	cleanup();
+}
+
+void GpuTimer::cleanup() {
+	vkDestroyQueryPool(_device.device(), _queryPool, nullptr);
+	_queryPool = VK_NULL_HANDLE;
+}
+
+GpuTimer::GpuTimer(GpuTimer&& other) noexcept : _device(other._device),
+	_queryPool(other._queryPool),
+	_supported(other._supported),
+	_timestampPeriod(other._timestampPeriod),
+	_timestampMask(other._timestampMask),
+	_zoneNames(std::move(other._zoneNames)),
+	_results(std::move(other._results)) {
+	other._queryPool = VK_NULL_HANDLE;
+	other._supported = false;
+}
+
+GpuTimer& GpuTimer::operator=(GpuTimer&& other) noexcept {
+	if (this != &other) {
+		cleanup();
+
+		_queryPool = other._queryPool;
+		_supported = other._supported;
+		_timestampPeriod = other._timestampPeriod;
+		_timestampMask = other._timestampMask;
+		_zoneNames = std::move(other._zoneNames);
+		_results = std::move(other._results);
+
+		other._queryPool = VK_NULL_HANDLE;
+		other._supported = false;
+	}
+	return *this;
+}
+
+void GpuTimer::begin(Command& cmd) {
+	if (!_supported) return;
+
+	if (!_zoneNames.empty()) {
+		// Each query returns its value followed by its availability. No WAIT flag, so zones that aren't available are skipped
+		uint32_t queryCount = 2 * static_cast<uint32_t>(_zoneNames.size());
+		std::vector<uint64_t> data(2 * queryCount, 0);
+		VkResult result = vkGetQueryPoolResults(_device.device(), _queryPool, 0, queryCount, data.size() * sizeof(uint64_t), data.data(),
+			2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		if (result == VK_SUCCESS || result == VK_NOT_READY) {
+			_results.clear();
+			for (size_t zone = 0; zone < _zoneNames.size(); zone++) {
+				const uint64_t* start = &data[4 * zone];
+				const uint64_t* end = &data[4 * zone + 2];
+				if (start[1] == 0 || end[1] == 0) continue;
+
+				uint64_t ticks = ((end[0] & _timestampMask) - (start[0] & _timestampMask)) & _timestampMask;
+				_results.push_back(GpuZoneTiming{ _zoneNames[zone], ticks * _timestampPeriod * 1e-6 });
+			}
+		}
+	}
+
+	_zoneNames.clear();
+	vkCmdResetQueryPool(cmd.buffer(), _queryPool, 0, 2 * maxZones);
+}
+
+uint32_t GpuTimer::beginZone(Command& cmd, const char* name) {
+	if (!_supported || _zoneNames.size() >= maxZones) return maxZones;
+
+	uint32_t zone = static_cast<uint32_t>(_zoneNames.size());
+	_zoneNames.push_back(name);
+	// Written once all previously recorded commands have finished, so the zone doesn't include earlier work
+	vkCmdWriteTimestamp2(cmd.buffer(), VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _queryPool, 2 * zone);
+	return zone;
+}
+
+void GpuTimer::endZone(Command& cmd, uint32_t zone) {
+	if (zone >= maxZones) return;
+	vkCmdWriteTimestamp2(cmd.buffer(), VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _queryPool, 2 * zone + 1);
+}
@@ -179,39 +179,41 @@ SwapchainImage& SwapchainImage::operator=(SwapchainImage&& other) noexcept {
 	return *this;
 }
 
-void Image::transitionImage(Command& cmd, VkImageLayout newLayout) {
-	VkImageAspectFlags aspectMask = (newLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
-	VkImageSubresourceRange subresourceRange{
-		.aspectMask = aspectMask,
-		.baseMipLevel = 0,
-		.levelCount = 1,
-		.baseArrayLayer = 0,
-		.layerCount = 1
-	};
-
-	VkImageMemoryBarrier2 imageBarrier{
-		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-		.pNext = nullptr,
-		.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-		.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
-		.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-		.dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT,
-		.oldLayout = _imageLayout,
-		.newLayout = newLayout,
-		.image = _image,
-		.subresourceRange = subresourceRange
-	};
-
-	VkDependencyInfo dependencyInfo{
-		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-		.pNext = nullptr,
-		.imageMemoryBarrierCount = 1,
-		.pImageMemoryBarriers = &imageBarrier
-	};
+// @brief The usual stages and accesses of an image in layout. As a source, reads have nothing to make available, and layouts that
+//		  don't say what used the image (e.g. UNDEFINED after acquiring a swapchain image) wait for every stage without flushing anything
+static BarrierScope layoutScope(VkImageLayout layout, bool source) {
+	switch (layout) {
+	case VK_IMAGE_LAYOUT_UNDEFINED:
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+		return source ? BarrierScope{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_NONE } : BarrierScopes::present;
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+		return source ? BarrierScopes::colorAttachmentWrite : BarrierScopes::colorAttachmentReadWrite;
+	case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL:
+		return BarrierScope{ VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+			source ? VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+		return BarrierScope{ VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			source ? VK_ACCESS_2_NONE : VK_ACCESS_2_SHADER_SAMPLED_READ_BIT };
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+		return source ? BarrierScope{ VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_NONE } : BarrierScopes::transferRead;
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+		return BarrierScopes::transferWrite;
+	default:
+		// GENERAL and the rest can be used by anything
+		return BarrierScope{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			source ? VK_ACCESS_2_MEMORY_WRITE_BIT : VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT };
+	}
+}
 
-	vkCmdPipelineBarrier2(cmd.buffer(), &dependencyInfo);
+void Image::transitionImage(Command& cmd, VkImageLayout newLayout, BarrierScope src, BarrierScope dst) {
+	VkImageAspectFlags aspectMask = (newLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+	BarrierBatch barriers;
+	barriers.image(*this, newLayout, src, dst, aspectMask);
+	barriers.record(cmd);
+}
 
-	_imageLayout = newLayout;
+void Image::transitionImage(Command& cmd, VkImageLayout newLayout) {
+	transitionImage(cmd, newLayout, layoutScope(_imageLayout, true), layoutScope(newLayout, false));
 }
 
 void Image::copyImageOnGPU(Command& cmd, Image& src, Image& dst) {
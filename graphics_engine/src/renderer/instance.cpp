@@ -46,13 +46,22 @@ Instance::Instance(const char* appName, const char* engineName, bool enableValid
 
 	// Request validation layers if enabled
 	VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
+	// Synchronization validation checks the stages and accesses of every barrier against the work around it, which the image layout
+	// transitions derive their scopes from
+	const VkValidationFeatureEnableEXT enabledValidationFeatures[] = { VK_VALIDATION_FEATURE_ENABLE_SYNCHRONIZATION_VALIDATION_EXT };
+	VkValidationFeaturesEXT validationFeatures{
+		.sType = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT,
+		.pNext = &debugCreateInfo,
+		.enabledValidationFeatureCount = 1,
+		.pEnabledValidationFeatures = enabledValidationFeatures
+	};
 	if (enableValidationLayers) {
 		// Request validation layers
 		instanceCreateInfo.enabledLayerCount = static_cast<uint32_t>(Instance::validationLayers.size());
 		instanceCreateInfo.ppEnabledLayerNames = Instance::validationLayers.data();
 
 		DebugMessenger::populateDebugMessengerCreateInfo(debugCreateInfo);
-		instanceCreateInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)& debugCreateInfo;
+		instanceCreateInfo.pNext = &validationFeatures;
 	}
 	else {
 		instanceCreateInfo.enabledLayerCount = 0;
@@ -107,6 +116,7 @@ void Instance::getRequiredInstanceExtensions(std::vector<const char*>& extension
 
 	if (validationLayers) {
 		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+		extensions.push_back(VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME); // Provided by the validation layer
 	}
 
 	logger.printExtensions("Required Instance Extensions:", extensions);
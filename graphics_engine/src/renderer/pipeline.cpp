@@ -1,12 +1,13 @@
 #include "renderer/pipeline.h"
 
 Pipeline::Pipeline() :
-	_device(nullptr), _pipeline(VK_NULL_HANDLE), _pipelineLayout(VK_NULL_HANDLE) {}
+	_device(nullptr), _pipeline(VK_NULL_HANDLE), _pipelineLayout(VK_NULL_HANDLE), _ownsLayout(true) {}
 
-Pipeline::Pipeline(const Device* device, VkPipeline pipeline, VkPipelineLayout pipelineLayout) : 
+Pipeline::Pipeline(const Device* device, VkPipeline pipeline, VkPipelineLayout pipelineLayout, bool ownsLayout) : 
 	_device(device),
 	_pipeline(pipeline),
-	_pipelineLayout(pipelineLayout) {}
+	_pipelineLayout(pipelineLayout),
+	_ownsLayout(ownsLayout) {}
 
 Pipeline::~Pipeline() {
 	cleanup();
@@ -16,7 +17,9 @@ void Pipeline::cleanup() {
 	if (!_device) return;
 
 	if (_pipelineLayout != VK_NULL_HANDLE) {
-		vkDestroyPipelineLayout(_device->device(), _pipelineLayout, nullptr);
+		if (_ownsLayout) {
+			vkDestroyPipelineLayout(_device->device(), _pipelineLayout, nullptr);
+		}
 		_pipelineLayout = VK_NULL_HANDLE;
 	}
 	if (_pipeline != VK_NULL_HANDLE) {
@@ -25,7 +28,7 @@ void Pipeline::cleanup() {
 	}
 }
 
-Pipeline::Pipeline(Pipeline&& other) noexcept : _pipeline(other._pipeline), _pipelineLayout(other._pipelineLayout), _device(other._device) {
+Pipeline::Pipeline(Pipeline&& other) noexcept : _pipeline(other._pipeline), _pipelineLayout(other._pipelineLayout), _ownsLayout(other._ownsLayout), _device(other._device) {
 	// Reset other pipeline's members
 	other._pipeline = VK_NULL_HANDLE;
 	other._pipelineLayout = VK_NULL_HANDLE;
@@ -38,6 +41,7 @@ Pipeline& Pipeline::operator=(Pipeline&& other) noexcept {
 		// Transfer ownership
 		_pipeline = other._pipeline;
 		_pipelineLayout = other._pipelineLayout;
+		_ownsLayout = other._ownsLayout;
 		// Keep the device reference intact (no need to reassign)
 
 		// Reset the moved-from object
@@ -68,3 +72,52 @@ VkPipelineLayoutCreateInfo PipelineLayout::pipelineLayoutCreateInfo(const std::v
 	return createInfo;
 }
 
+// ---------------------------------------------- PIPELINE LAYOUT CACHE -----------------------------------------------------------------
+
+PipelineLayoutCache::PipelineLayoutCache(const Device& device) : _device(device) {}
+
+PipelineLayoutCache::~PipelineLayoutCache() {
+	for (const auto& [key, layout] : _layouts) {
+		vkDestroyPipelineLayout(_device.device(), layout, nullptr);
+	}
+}
+
+bool PipelineLayoutCache::LayoutKey::operator==(const LayoutKey& other) const {
+	if (setLayouts != other.setLayouts || pushConstantRanges.size() != other.pushConstantRanges.size()) return false;
+	for (size_t i = 0; i < pushConstantRanges.size(); i++) {
+		const VkPushConstantRange& a = pushConstantRanges[i];
+		const VkPushConstantRange& b = other.pushConstantRanges[i];
+		if (a.stageFlags != b.stageFlags || a.offset != b.offset || a.size != b.size) return false;
+	}
+	return true;
+}
+
+size_t PipelineLayoutCache::LayoutKeyHash::operator()(const LayoutKey& key) const {
+	size_t hash = key.setLayouts.size();
+	auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2); };
+	for (VkDescriptorSetLayout layout : key.setLayouts) {
+		combine(std::hash<VkDescriptorSetLayout>{}(layout));
+	}
+	for (const VkPushConstantRange& range : key.pushConstantRanges) {
+		combine(static_cast<size_t>((static_cast<uint64_t>(range.stageFlags) << 32) ^ (static_cast<uint64_t>(range.offset) << 16) ^ range.size));
+	}
+	return hash;
+}
+
+VkPipelineLayout PipelineLayoutCache::get(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges) {
+	LayoutKey key{ setLayouts, pushConstantRanges };
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto found = _layouts.find(key);
+	if (found != _layouts.end()) {
+		return found->second;
+	}
+	VkPipelineLayout layout = PipelineLayout::createPipelineLayout(_device, PipelineLayout::pipelineLayoutCreateInfo(setLayouts, pushConstantRanges));
+	_layouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+size_t PipelineLayoutCache::size() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _layouts.size();
+}
@@ -1,12 +1,26 @@
 #include "renderer/pipeline_builder.h"
 
-PipelineBuilder::PipelineBuilder(const Device& device) : _device(device) {
+PipelineBuilder::PipelineBuilder(const Device& device, const PipelineCache& pipelineCache, PipelineLayoutCache& layoutCache) :
+	_device(device), _pipelineCache(pipelineCache), _layoutCache(layoutCache) {
 	clear();
 }
 
 Pipeline PipelineBuilder::buildPipeline() {
+    return build(_config);
+}
+
+std::future<Pipeline> PipelineBuilder::buildPipelineAsync() {
+    return std::async(std::launch::async, [this, config = _config]() { return build(config); });
+}
+
+Pipeline PipelineBuilder::build(PipelineConfig config) const {
     static Logger& logger = Logger::getLogger();
 
+    // The copy's rendering info must point at its own format, not at the builder's
+    if (config.renderingInfo.colorAttachmentCount > 0) {
+        config.renderingInfo.pColorAttachmentFormats = &config.colorAttachmentFormat;
+    }
+
     VkPipelineViewportStateCreateInfo viewportState{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
         .pNext = nullptr,
@@ -21,7 +35,7 @@ Pipeline PipelineBuilder::buildPipeline() {
         .logicOpEnable = VK_FALSE,
         .logicOp = VK_LOGIC_OP_COPY,
         .attachmentCount = 1,
-        .pAttachments = &_config.colorBlendAttachment
+        .pAttachments = &config.colorBlendAttachment
     };
     
     // Not used yet so just initialize it to default
@@ -37,21 +51,21 @@ Pipeline PipelineBuilder::buildPipeline() {
         .pDynamicStates = &state[0]
     };
 
-    VkPipelineLayout layout = PipelineLayout::createPipelineLayout(_device,
-        PipelineLayout::pipelineLayoutCreateInfo(_config.descriptorSetLayouts, _config.pushConstantRanges));
+    // Pipelines with the same sets and push constants share one layout
+    VkPipelineLayout layout = _layoutCache.get(config.descriptorSetLayouts, config.pushConstantRanges);
 
     // Build the pipeline
     VkGraphicsPipelineCreateInfo pipelineInfo{
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .pNext = &_config.renderingInfo,
-        .stageCount = static_cast<uint32_t>(_config.shaderModules.size()),
-        .pStages = _config.shaderModules.data(),
+        .pNext = &config.renderingInfo,
+        .stageCount = static_cast<uint32_t>(config.shaderModules.size()),
+        .pStages = config.shaderModules.data(),
         .pVertexInputState = &vertexInputInfo,
-        .pInputAssemblyState = &_config.inputAssembly,
+        .pInputAssemblyState = &config.inputAssembly,
         .pViewportState = &viewportState,
-        .pRasterizationState = &_config.rasterizer,
-        .pMultisampleState = &_config.multisampling,
-        .pDepthStencilState = &_config.depthStencil,
+        .pRasterizationState = &config.rasterizer,
+        .pMultisampleState = &config.multisampling,
+        .pDepthStencilState = &config.depthStencil,
         .pColorBlendState = &colorBlending,
         .pDynamicState = &dynamicState,
         .layout = layout,
@@ -59,11 +73,11 @@ Pipeline PipelineBuilder::buildPipeline() {
     };
 
     VkPipeline vkPipeline;
-    if (vkCreateGraphicsPipelines(_device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &vkPipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(_device.device(), _pipelineCache.handle(), 1, &pipelineInfo, nullptr, &vkPipeline) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create pipeline");
     }
 
-    Pipeline newPipeline(&_device, vkPipeline, layout);
+    Pipeline newPipeline(&_device, vkPipeline, layout, false);
     logger.print("Successfully Created Render Pipeline");
 
     return newPipeline;
@@ -71,6 +85,7 @@ Pipeline PipelineBuilder::buildPipeline() {
 
 void PipelineBuilder::clear() {
     _config.shaderModules.clear();
+    _config.heldShaders.clear();
     _config.vertexInputInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
     _config.inputAssembly = { .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
     _config.rasterizer = { .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
@@ -96,6 +111,12 @@ PipelineBuilder& PipelineBuilder::setShader(Shader& shader) {
     return *this;
 }
 
+PipelineBuilder& PipelineBuilder::setShader(std::shared_ptr<Shader> shader) {
+    setShader(*shader);
+    _config.heldShaders.push_back(std::move(shader));
+    return *this;
+}
+
 // Pipeline State
 
 PipelineBuilder& PipelineBuilder::setInputTopology(VkPrimitiveTopology topology) {
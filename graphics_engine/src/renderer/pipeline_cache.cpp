@@ -0,0 +1,121 @@
+#include "renderer/pipeline_cache.h"
+#include "renderer/device.h"
+#include "utility/logger.h"
+#include "utility/mapped_file.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+// @brief Name of the cache file of a device and driver, e.g. pipeline_cache_10de_2684_<uuid>.bin
+static std::string cacheFileName(const VkPhysicalDeviceProperties& properties) {
+	std::stringstream name;
+	name << "pipeline_cache_" << std::hex << std::setfill('0') << std::setw(4) << properties.vendorID << "_" << std::setw(4) << properties.deviceID << "_";
+	for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+		name << std::setw(2) << static_cast<uint32_t>(properties.pipelineCacheUUID[i]);
+	}
+	name << ".bin";
+	return name.str();
+}
+
+PipelineCache::PipelineCache(const Device& device, const std::string& directory) :
+	_device(device), _cache(VK_NULL_HANDLE), _loadedSize(0), _savedSize(0) {
+	static Logger& logger = Logger::getLogger();
+
+	std::filesystem::path path = std::filesystem::path(directory) / cacheFileName(_device.physicalDeviceProperies());
+	_path = path.string();
+
+	std::vector<std::byte> initialData;
+	std::error_code error;
+	if (std::filesystem::exists(path, error)) {
+		try {
+			MappedFile file(_path);
+			if (validHeader(file.data(), file.size())) {
+				initialData.assign(file.data(), file.data() + file.size());
+			}
+			else {
+				logger.print("Ignoring pipeline cache " + _path + ": it was written for another device or driver");
+			}
+		}
+		catch (const std::exception& e) {
+			logger.print("Ignoring pipeline cache " + _path + ": " + e.what());
+		}
+	}
+
+	VkPipelineCacheCreateInfo createInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.initialDataSize = initialData.size(),
+		.pInitialData = initialData.empty() ? nullptr : initialData.data()
+	};
+	if (vkCreatePipelineCache(_device.device(), &createInfo, nullptr, &_cache) != VK_SUCCESS) {
+		// The header matched but the driver still rejected the contents. Start cold rather than fail
+		logger.print("Driver rejected pipeline cache " + _path + ", starting with an empty cache");
+		initialData.clear();
+		createInfo.initialDataSize = 0;
+		createInfo.pInitialData = nullptr;
+		if (vkCreatePipelineCache(_device.device(), &createInfo, nullptr, &_cache) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create pipeline cache!");
+		}
+	}
+
+	_loadedSize = initialData.size();
+	_savedSize = _loadedSize;
+	logger.print(_loadedSize > 0 ? "Loaded pipeline cache " + _path + " (" + std::to_string(_loadedSize) + " bytes)" : "Starting with an empty pipeline cache");
+}
+
+PipelineCache::~PipelineCache() {
+	if (_cache == VK_NULL_HANDLE) return;
+	try {
+		save();
+	}
+	catch (const std::exception& e) {
+		Logger::getLogger().print(std::string("Failed to save the pipeline cache: ") + e.what());
+	}
+	vkDestroyPipelineCache(_device.device(), _cache, nullptr);
+}
+
+bool PipelineCache::validHeader(const std::byte* data, size_t size) const {
+	VkPipelineCacheHeaderVersionOne header{};
+	if (size < sizeof(header)) return false;
+	std::memcpy(&header, data, sizeof(header));
+
+	VkPhysicalDeviceProperties properties = _device.physicalDeviceProperies();
+	return header.headerSize >= sizeof(header) && header.headerSize <= size
+		&& header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		&& header.vendorID == properties.vendorID
+		&& header.deviceID == properties.deviceID
+		&& std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::save() {
+	static Logger& logger = Logger::getLogger();
+
+	size_t size = 0;
+	if (vkGetPipelineCacheData(_device.device(), _cache, &size, nullptr) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to query the pipeline cache size!");
+	}
+	// Caches only grow, so an unchanged size means no new pipeline was compiled
+	if (size == _savedSize) return;
+
+	std::vector<std::byte> data(size);
+	if (vkGetPipelineCacheData(_device.device(), _cache, &size, data.data()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to read the pipeline cache!");
+	}
+
+	std::string temporaryPath = _path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file || !file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(size))) {
+			throw std::runtime_error("Failed to write pipeline cache " + temporaryPath);
+		}
+	}
+	std::filesystem::rename(temporaryPath, _path);
+
+	_savedSize = size;
+	logger.print("Saved pipeline cache " + _path + " (" + std::to_string(size) + " bytes)");
+}
@@ -0,0 +1,361 @@
+#include "renderer/render_graph.h"
+#include "renderer/device.h"
+#include "utility/allocator.h"
+#include <algorithm>
+#include <stdexcept>
+
+static const uint32_t releaseAfterFrames = 16; // Transient allocations unused for this long are freed. Longer than any frame is in flight
+
+// ----------------------------------------------- PASSES --------------------------------------------- //
+
+RenderGraphPass& RenderGraphPass::read(RenderGraphResource resource, ResourceUsage usage) {
+	_accesses.push_back(Access{ resource, usage, false });
+	return *this;
+}
+
+RenderGraphPass& RenderGraphPass::write(RenderGraphResource resource, ResourceUsage usage) {
+	_accesses.push_back(Access{ resource, usage, true });
+	return *this;
+}
+
+RenderGraphPass& RenderGraphPass::colorAttachment(RenderGraphResource resource, std::optional<VkClearValue> clear) {
+	// Loading the attachment reads what the earlier passes wrote, clearing it doesn't
+	if (!clear) {
+		read(resource, ResourceUsage::colorAttachment);
+	}
+	write(resource, ResourceUsage::colorAttachment);
+	_colorAttachment = resource;
+	_clear = clear;
+	return *this;
+}
+
+RenderGraphPass& RenderGraphPass::sideEffects() {
+	_sideEffects = true;
+	return *this;
+}
+
+RenderGraphPass& RenderGraphPass::execute(std::function<void(Command&)> callback) {
+	_execute = std::move(callback);
+	return *this;
+}
+
+// ----------------------------------------------- GRAPH --------------------------------------------- //
+
+RenderGraph::RenderGraph(const Device& device, const Allocator& allocator) : _device(device), _allocator(allocator) {}
+
+void RenderGraph::reset() {
+	_resources.clear();
+	_passes.clear();
+	_compiled = false;
+}
+
+RenderGraphResource RenderGraph::importImage(const std::string& name, Image& image, VkPipelineStageFlags2 initialStage, VkAccessFlags2 initialAccess) {
+	Resource resource{ .name = name, .isImage = true, .image = &image };
+	resource.state.layout = image.imageLayout();
+	resource.state.writeStages = initialStage;
+	resource.state.writeAccess = initialAccess;
+	_resources.push_back(std::move(resource));
+	return static_cast<RenderGraphResource>(_resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::importBuffer(const std::string& name, VkBuffer buffer, VkPipelineStageFlags2 initialStage, VkAccessFlags2 initialAccess) {
+	Resource resource{ .name = name, .isImage = false, .buffer = buffer };
+	resource.state.writeStages = initialStage;
+	resource.state.writeAccess = initialAccess;
+	_resources.push_back(std::move(resource));
+	return static_cast<RenderGraphResource>(_resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::createImage(const std::string& name, const TransientImageDescription& description) {
+	_resources.push_back(Resource{ .name = name, .isImage = true, .transient = true, .description = description });
+	return static_cast<RenderGraphResource>(_resources.size() - 1);
+}
+
+void RenderGraph::setOutput(RenderGraphResource resource, ResourceUsage finalUsage) {
+	_resources.at(resource).finalUsage = finalUsage;
+}
+
+RenderGraphPass& RenderGraph::addPass(const std::string& name) {
+	_passes.push_back(std::unique_ptr<RenderGraphPass>(new RenderGraphPass(name)));
+	return *_passes.back();
+}
+
+Image& RenderGraph::image(RenderGraphResource resource) {
+	Resource& graphResource = _resources.at(resource);
+	if (!graphResource.isImage || !graphResource.image) {
+		throw std::runtime_error("Render graph resource " + graphResource.name + " has no image (yet)");
+	}
+	return *graphResource.image;
+}
+
+RenderGraph::UsageInfo RenderGraph::usageInfo(ResourceUsage usage, bool write) {
+	switch (usage) {
+	case ResourceUsage::colorAttachment:
+		return UsageInfo{ VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+			write ? VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT : VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT,
+			write ? VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT : VK_ACCESS_2_NONE,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, write };
+	case ResourceUsage::sampled:
+		return UsageInfo{ VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_ACCESS_2_NONE,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false };
+	case ResourceUsage::storageRead:
+		return UsageInfo{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_ACCESS_2_NONE,
+			VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false };
+	case ResourceUsage::storageWrite:
+		return UsageInfo{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, true };
+	case ResourceUsage::vertexShaderRead:
+		return UsageInfo{ VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+			VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false };
+	case ResourceUsage::transferSrc:
+		return UsageInfo{ VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_ACCESS_2_NONE,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false };
+	case ResourceUsage::transferDst:
+		return UsageInfo{ VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, true };
+	case ResourceUsage::present:
+		// Presentation waits on the render semaphore, which the submission signals after every command, barriers included
+		return UsageInfo{ VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0, false };
+	}
+	throw std::runtime_error("Unknown render graph resource usage");
+}
+
+void RenderGraph::compile() {
+	cullPasses();
+	assignTransientImages();
+	_compiled = true;
+}
+
+void RenderGraph::cullPasses() {
+	// Walk the passes backwards from the outputs. A pass is needed if it has side effects or writes something a later needed pass
+	// reads (or an output); the resources it reads are then needed from the passes before it
+	std::vector<bool> needed(_resources.size(), false);
+	for (size_t i = 0; i < _resources.size(); i++) {
+		needed[i] = _resources[i].finalUsage.has_value();
+	}
+
+	_statistics = RenderGraphStatistics{ .passes = static_cast<uint32_t>(_passes.size()) };
+	for (size_t p = _passes.size(); p-- > 0;) {
+		RenderGraphPass& pass = *_passes[p];
+		bool keep = pass._sideEffects;
+		for (const RenderGraphPass::Access& access : pass._accesses) {
+			if (access.resource >= _resources.size()) {
+				throw std::runtime_error("Pass " + pass._name + " uses a resource that wasn't declared in this graph");
+			}
+			keep = keep || (access.write && needed[access.resource]);
+		}
+		pass._culled = !keep;
+		if (!keep) {
+			_statistics.culledPasses++;
+			continue;
+		}
+		for (const RenderGraphPass::Access& access : pass._accesses) {
+			if (!access.write) needed[access.resource] = true;
+		}
+	}
+
+	// Lifetimes and usage flags only count the passes that run
+	for (size_t p = 0; p < _passes.size(); p++) {
+		if (_passes[p]->_culled) continue;
+		for (const RenderGraphPass::Access& access : _passes[p]->_accesses) {
+			Resource& resource = _resources[access.resource];
+			if (resource.firstPass < 0) resource.firstPass = static_cast<int>(p);
+			resource.lastPass = static_cast<int>(p);
+			resource.imageUsage |= usageInfo(access.usage, access.write).imageUsage;
+		}
+	}
+}
+
+void RenderGraph::assignTransientImages() {
+	for (PhysicalImage& physical : _physicalImages) {
+		physical.availableAfter = -1;
+		physical.unusedFrames++;
+	}
+
+	// Transient images are assigned in the order they are first used, each to the first allocation of the same description that is
+	// free by then. Its state carries the accesses of the previous user over, so the first barrier waits for them
+	std::vector<RenderGraphResource> transients;
+	for (size_t i = 0; i < _resources.size(); i++) {
+		if (_resources[i].transient && _resources[i].firstPass >= 0) transients.push_back(static_cast<RenderGraphResource>(i));
+	}
+	std::sort(transients.begin(), transients.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+		return _resources[a].firstPass < _resources[b].firstPass;
+	});
+
+	for (RenderGraphResource handle : transients) {
+		Resource& resource = _resources[handle];
+		int physicalIndex = -1;
+		for (size_t i = 0; i < _physicalImages.size(); i++) {
+			PhysicalImage& physical = _physicalImages[i];
+			bool sameDescription = physical.description.format == resource.description.format
+				&& physical.description.extent.width == resource.description.extent.width
+				&& physical.description.extent.height == resource.description.extent.height
+				&& physical.description.extent.depth == resource.description.extent.depth;
+			if (sameDescription && (physical.usage & resource.imageUsage) == resource.imageUsage && physical.availableAfter < resource.firstPass) {
+				physicalIndex = static_cast<int>(i);
+				break;
+			}
+		}
+
+		if (physicalIndex < 0) {
+			PhysicalImage physical{
+				.image = std::make_unique<AllocatedImage>(_device, _allocator, resource.description.extent, resource.description.format,
+					resource.imageUsage, VMA_MEMORY_USAGE_GPU_ONLY, VkMemoryAllocateFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), VK_IMAGE_ASPECT_COLOR_BIT),
+				.description = resource.description,
+				.usage = resource.imageUsage,
+				.availableAfter = -1,
+				.unusedFrames = 0
+			};
+			_physicalImages.push_back(std::move(physical));
+			physicalIndex = static_cast<int>(_physicalImages.size() - 1);
+		}
+
+		PhysicalImage& physical = _physicalImages[physicalIndex];
+		physical.availableAfter = resource.lastPass;
+		physical.unusedFrames = 0;
+		resource.physicalImage = physicalIndex;
+		resource.image = physical.image.get();
+		_statistics.transientImages++;
+	}
+
+	// Allocations no frame in flight can still be using are freed, e.g. the transient images of the window size before a resize
+	std::erase_if(_physicalImages, [](const PhysicalImage& physical) { return physical.unusedFrames > releaseAfterFrames; });
+	for (size_t i = 0; i < _resources.size(); i++) {
+		Resource& resource = _resources[i];
+		if (resource.physicalImage < 0) continue;
+		// Indices moved if allocations before this one were freed. Unused allocations are never assigned, so find it again by pointer
+		for (size_t j = 0; j < _physicalImages.size(); j++) {
+			if (_physicalImages[j].image.get() == resource.image) resource.physicalImage = static_cast<int>(j);
+		}
+	}
+	_statistics.physicalImages = static_cast<uint32_t>(_physicalImages.size());
+}
+
+void RenderGraph::transition(Resource& resource, const UsageInfo& info) {
+	ResourceState& state = resource.state;
+	bool layoutChange = resource.isImage && info.layout != state.layout;
+
+	VkPipelineStageFlags2 srcStage = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 srcAccess = VK_ACCESS_2_NONE;
+	bool needsBarrier = false;
+	if (layoutChange || info.write) {
+		// Writes (and layout transitions, which write the image) wait for every earlier use: the last write and every read since
+		srcStage = state.writeStages | state.readStages;
+		srcAccess = state.writeAccess;
+		needsBarrier = srcStage != VK_PIPELINE_STAGE_2_NONE || layoutChange;
+
+		// A transition made for a read is a write the next readers have to wait for, but there is nothing to make visible
+		state.writeStages = info.stage;
+		state.writeAccess = info.writeAccess;
+		state.readStages = info.write ? VK_PIPELINE_STAGE_2_NONE : info.stage;
+		state.visibleStages = info.stage;
+		state.visibleAccess = info.access;
+		state.layout = info.layout;
+	}
+	else {
+		// Reads after reads in the same layout need no barrier, unless the last write isn't visible to this stage and access yet
+		bool visible = (info.stage & ~state.visibleStages) == 0 && (info.access & ~state.visibleAccess) == 0;
+		if (state.writeStages != VK_PIPELINE_STAGE_2_NONE && !visible) {
+			srcStage = state.writeStages;
+			srcAccess = state.writeAccess;
+			needsBarrier = true;
+			state.visibleStages |= info.stage;
+			state.visibleAccess |= info.access;
+		}
+		state.readStages |= info.stage;
+	}
+	if (!needsBarrier) return;
+
+	if (resource.isImage) {
+		_barriers.image(*resource.image, info.layout, BarrierScope{ srcStage, srcAccess }, BarrierScope{ info.stage, info.access });
+	}
+	else {
+		_barriers.buffer(resource.buffer, BarrierScope{ srcStage, srcAccess }, BarrierScope{ info.stage, info.access });
+	}
+}
+
+void RenderGraph::flushBarriers(Command& cmd) {
+	uint32_t count = _barriers.record(cmd);
+	if (count > 0) {
+		_statistics.barriers += count;
+		_statistics.barrierBatches++;
+	}
+}
+
+void RenderGraph::execute(Command& cmd) {
+	if (!_compiled) {
+		throw std::runtime_error("Render graph must be compiled before it is executed");
+	}
+
+	std::vector<std::pair<RenderGraphResource, UsageInfo>> uses;
+	for (size_t p = 0; p < _passes.size(); p++) {
+		RenderGraphPass& pass = *_passes[p];
+		if (pass._culled) continue;
+
+		// A transient image starts from whatever its allocation was last used for. Its contents are discarded
+		for (Resource& resource : _resources) {
+			if (resource.transient && resource.firstPass == static_cast<int>(p)) {
+				resource.state = _physicalImages[resource.physicalImage].state;
+				resource.state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+				resource.image->setImageLayout(VK_IMAGE_LAYOUT_UNDEFINED);
+			}
+		}
+
+		// Merge the pass's accesses of each resource into one use, so a read and a write of the same resource get a single barrier
+		uses.clear();
+		for (const RenderGraphPass::Access& access : pass._accesses) {
+			UsageInfo info = usageInfo(access.usage, access.write);
+			auto use = std::find_if(uses.begin(), uses.end(), [&access](const auto& use) { return use.first == access.resource; });
+			if (use == uses.end()) {
+				uses.emplace_back(access.resource, info);
+				continue;
+			}
+			if (_resources[access.resource].isImage && use->second.layout != info.layout) {
+				throw std::runtime_error("Pass " + pass._name + " uses image " + _resources[access.resource].name + " in two layouts");
+			}
+			use->second.stage |= info.stage;
+			use->second.access |= info.access;
+			use->second.writeAccess |= info.writeAccess;
+			use->second.write = use->second.write || info.write;
+		}
+		for (auto& [handle, info] : uses) {
+			transition(_resources[handle], info);
+		}
+		flushBarriers(cmd);
+
+		if (pass._colorAttachment) {
+			Image& target = *_resources[*pass._colorAttachment].image;
+			VkClearValue clearValue = pass._clear.value_or(VkClearValue{});
+			VkRenderingAttachmentInfoKHR colorAttachmentInfo = Image::attachmentInfo(target.imageView(), pass._clear ? &clearValue : nullptr,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+			VkRenderingInfoKHR renderingInfo{
+				.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
+				.pNext = nullptr,
+				.renderArea = VkRect2D{ { 0, 0 }, { target.extent().width, target.extent().height } },
+				.layerCount = 1,
+				.colorAttachmentCount = 1,
+				.pColorAttachments = &colorAttachmentInfo
+			};
+			vkCmdBeginRendering(cmd.buffer(), &renderingInfo);
+			if (pass._execute) pass._execute(cmd);
+			vkCmdEndRendering(cmd.buffer());
+		}
+		else if (pass._execute) {
+			pass._execute(cmd);
+		}
+
+		for (Resource& resource : _resources) {
+			if (resource.transient && resource.lastPass == static_cast<int>(p)) {
+				_physicalImages[resource.physicalImage].state = resource.state;
+			}
+		}
+	}
+
+	// Leave the outputs the way the rest of the frame expects them, e.g. ready for presentation
+	for (Resource& resource : _resources) {
+		if (resource.finalUsage && resource.firstPass >= 0) {
+			transition(resource, usageInfo(*resource.finalUsage, false));
+		}
+	}
+	flushBarriers(cmd);
+}
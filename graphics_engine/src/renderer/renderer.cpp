@@ -1,4 +1,6 @@
 #include "renderer/renderer.h"
+#include "utility/profiler.h"
+#include "utility/timer.h"
 
 Renderer::Renderer(Window& window) :
 	_window(window), 
@@ -7,13 +9,20 @@ Renderer::Renderer(Window& window) :
 	_device(_instance, _window, Instance::deviceExtensions),
 	_allocator(_device, _instance),
 	_swapchain(_device, _window),
-	_pipelineBuilder(_device),
+	_pipelineCache(_device),
+	_shaderLibrary(_device),
+	_descriptorLayoutCache(_device),
+	_pipelineLayoutCache(_device),
+	_bindlessTable(_device, _descriptorLayoutCache, _pipelineLayoutCache),
+	_pipelineBuilder(_device, _pipelineCache, _pipelineLayoutCache),
 	_frameNumber(0),
-	_drawImage(_device, _allocator, VkExtent3D{ _window.extent().width, _window.extent().height, 1 }, _swapchain.imageFormat(),
-		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		VMA_MEMORY_USAGE_GPU_ONLY, VkMemoryAllocateFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), VK_IMAGE_ASPECT_COLOR_BIT),
-	_descriptorLayoutBuilder(_device),
-	_descriptorWriter(_device) {
+	_drawImage(_device, _allocator),
+	_rendersOffscreen(false),
+	_descriptorLayoutBuilder(_descriptorLayoutCache),
+	_descriptorWriter(_device),
+	_descriptorAllocator(_device),
+	_uploadHeap(_device, _allocator, _descriptorLayoutCache, _descriptorAllocator, _swapchain.framesInFlight()),
+	_renderGraph(_device, _allocator) {
 
 	static Logger& logger = Logger::getLogger();
 
@@ -29,20 +38,6 @@ Renderer::Renderer(Window& window) :
 	logger.print("Engine Initiated!");
 }
 
-static VkRenderingInfoKHR renderingInfoKHR(VkExtent2D extent, uint32_t colorAttachmentCount, VkRenderingAttachmentInfo* pColorAttachmentInfos, VkRenderingAttachmentInfo* pDepthAttachmentInfo) {
-	VkRenderingInfoKHR renderInfo{
-		.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
-		.pNext = nullptr,
-		.layerCount = 1,
-		.colorAttachmentCount = colorAttachmentCount,
-		.pColorAttachments = pColorAttachmentInfos,
-		.pDepthAttachment = pDepthAttachmentInfo
-	};
-	renderInfo.renderArea.extent = extent;
-	renderInfo.renderArea.offset = { 0, 0 };
-	return renderInfo;
-}
-
 Frame& Renderer::getCurrentFrame() {
 	return _frames[_frameNumber % _swapchain.framesInFlight()];
 }
@@ -52,92 +47,155 @@ Frame& Renderer::getFrame(int index) {
 }
 
 Renderer& Renderer::addRenderSystem(RenderSystem* renderSystem) {
+	static Logger& logger = Logger::getLogger();
+
 	_renderSystems.push_back(renderSystem);
+	if (renderSystem->requiresOffscreenTarget() && !_rendersOffscreen) {
+		createDrawImage();
+		_rendersOffscreen = true;
+		logger.print("Rendering offscreen, required by render system " + std::string(renderSystem->name()));
+	}
 	return *this;
 }
 
+void Renderer::createDrawImage() {
+	_drawImage = AllocatedImage(_device, _allocator, VkExtent3D{ _window.extent().width, _window.extent().height, 1 }, _swapchain.imageFormat(),
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+		VMA_MEMORY_USAGE_GPU_ONLY, VkMemoryAllocateFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
 void Renderer::renderAllSystems() {
+	PROFILE_ZONE("Render");
+	FrameStatistics& frameStatistics = Timer::getTimer().statistics();
+
 	// First, wait for the the last frame to render
 	VkFence currentRenderFence = getCurrentFrame().renderFence().handle();
-	vkWaitForFences(_device.device(), 1, &currentRenderFence, true, 1000000000);
-	// Here would be the place to delete all objects from the previous frame (like descriptor sets, etc)
+	{
+		PROFILE_ZONE("Fence Wait");
+		FramePhaseTimer phase(frameStatistics, FramePhase::fenceWait);
+		vkWaitForFences(_device.device(), 1, &currentRenderFence, true, 1000000000);
+	}
+	// The GPU is done with everything the frame used last time, so its per-frame descriptor sets can all be returned at once
 	vkResetFences(_device.device(), 1, &currentRenderFence);
+	getCurrentFrame().transientDescriptors().reset();
+	// A pipeline retired during frame N was last recorded in frame N - 1 at the latest. Every frame up to N - 1 has finished once the
+	// fence of frame N - 1 + framesInFlight has been waited on, which the check below is one frame more conservative than
+	std::erase_if(_retiredPipelines, [this](const auto& retired) { return retired.first + _swapchain.framesInFlight() <= _frameNumber; });
+
+	// Changed shaders are picked up at the frame boundary, before any system records with its pipelines
+	_shaderHotReloader.update();
 
 	// Next, request current frame's image from the swapchain
-	_swapchain.acquireNextImage(&getCurrentFrame().presentSemaphore(), nullptr);
+	{
+		PROFILE_ZONE("Acquire");
+		_swapchain.acquireNextImage(&getCurrentFrame().presentSemaphore(), nullptr);
+	}
 
+	ProfileZone recordZone("Record");
+	FramePhaseTimer recordPhase(frameStatistics, FramePhase::cpuRecord);
 	// Get the current frame's command buffer
 	Command& cmd = getCurrentFrame().command();
 	cmd.reset(); // Reset before adding more commands to be safe
 	cmd.begin(); // Begin the command buffer
-	
-	// Transition the draw image to a writable format
-	_drawImage.transitionImage(cmd, VK_IMAGE_LAYOUT_GENERAL);
-	
-	// Now the rendering info struct needs to be filled with the leftover info that the renderpass usually handles
+
+	// The fence wait above guarantees this frame's previous timestamps are written, so reading them back doesn't stall
+	GpuTimer& gpuTimer = getCurrentFrame().gpuTimer();
+	gpuTimer.begin(cmd);
+	for (const GpuZoneTiming& timing : gpuTimer.results()) {
+		Profiler::getProfiler().recordGpuTime(timing.name, timing.milliseconds);
+	}
+	uint32_t frameZone = gpuTimer.beginZone(cmd, "Frame");
+
+	// Without a render system that needs the frame offscreen, the systems draw straight into the swapchain image. That saves copying
+	// the whole frame every frame (a read and a write of every pixel) and the draw image's memory. Both have the swapchain's format
+	_renderGraph.reset();
+	// The acquire semaphore is waited on at the color attachment output stage, so the first barrier on the swapchain image must wait there
+	RenderGraphResource swapchainImage = _renderGraph.importImage("Swapchain", _swapchain.image(_swapchain.imageIndex()),
+		VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE);
+	_renderGraph.setOutput(swapchainImage, ResourceUsage::present);
+	RenderGraphResource sceneTarget = _rendersOffscreen ? _renderGraph.importImage("Draw Image", _drawImage) : swapchainImage;
+
+	// The target is cleared when rendering begins, so its previous contents don't matter
 	VkClearValue clearColorValue{ .color{ 0.0f, 0.0f, 0.0f, 1.0f } };
-	VkRenderingAttachmentInfoKHR colorAttachmentInfo = Image::attachmentInfo(_drawImage.imageView(), &clearColorValue, VK_IMAGE_LAYOUT_GENERAL);
-	VkRenderingInfoKHR renderingInfo = renderingInfoKHR(_window.extent(), 1, &colorAttachmentInfo, nullptr);
-
-	// Transition draw image to a color attachment
-	_drawImage.transitionImage(cmd, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-
-	// Set dynamic viewport and scissor
-	VkViewport viewport{
-		.x = 0.0f,
-		.y = 0.0f,
-		.width = static_cast<float>(_window.extent().width),
-		.height = static_cast<float>(_window.extent().height),
-		.minDepth = 0.0f,
-		.maxDepth = 1.0f
-	};
-
-	VkRect2D scissor{
-		.offset = {0, 0},
-		.extent = _window.extent()
-	};
-
-	vkCmdBeginRendering(cmd.buffer(), &renderingInfo);
-
-	// First, set the dynamic states: viewport and scissor
-	vkCmdSetViewport(cmd.buffer(), 0, 1, &viewport);
-	vkCmdSetScissor(cmd.buffer(), 0, 1, &scissor);
-
-	// We want to do imgui rendering here I think. It's either first or last. Maybe last since it's an overlay
-
-	// Call render() for each RenderSystem. Note that the order in which these systems are called matters.
-	for (auto* renderSystem : _renderSystems) {
-		renderSystem->render(cmd);
+	VkExtent2D renderExtent = _rendersOffscreen ? _window.extent() : _swapchain.extent();
+	_renderGraph.addPass("Scene")
+		.colorAttachment(sceneTarget, clearColorValue)
+		.execute([this, &gpuTimer, renderExtent](Command& cmd) {
+			// First, set the dynamic states: viewport and scissor
+			VkViewport viewport{
+				.x = 0.0f,
+				.y = 0.0f,
+				.width = static_cast<float>(renderExtent.width),
+				.height = static_cast<float>(renderExtent.height),
+				.minDepth = 0.0f,
+				.maxDepth = 1.0f
+			};
+			VkRect2D scissor{
+				.offset = {0, 0},
+				.extent = renderExtent
+			};
+			vkCmdSetViewport(cmd.buffer(), 0, 1, &viewport);
+			vkCmdSetScissor(cmd.buffer(), 0, 1, &scissor);
+
+			// Call render() for each RenderSystem. Note that the order in which these systems are called matters.
+			for (auto* renderSystem : _renderSystems) {
+				uint32_t zone = gpuTimer.beginZone(cmd, renderSystem->name());
+				// Once per system rather than once per pass, as a system may bind sets of its own over it (the GUI does)
+				_bindlessTable.bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS);
+				renderSystem->render(cmd);
+				gpuTimer.endZone(cmd, zone);
+			}
+		});
+
+	if (_rendersOffscreen) {
+		_renderGraph.addPass("Blit")
+			.read(sceneTarget, ResourceUsage::transferSrc)
+			.write(swapchainImage, ResourceUsage::transferDst)
+			.execute([this, &gpuTimer, sceneTarget, swapchainImage](Command& cmd) {
+				uint32_t blitZone = gpuTimer.beginZone(cmd, "Blit");
+				Image::copyImageOnGPU(cmd, _renderGraph.image(sceneTarget), _renderGraph.image(swapchainImage));
+				gpuTimer.endZone(cmd, blitZone);
+			});
 	}
 
-	vkCmdEndRendering(cmd.buffer());
-
-	// Transition images for copying and then presenting
-	// Draw image is going to be copied to the swapchain image, so transition it to a transfer source layout
-	_drawImage.transitionImage(cmd, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-	// Swapchain image needs to be transitioned to a transfer destination layout
-	_swapchain.image(_swapchain.imageIndex()).transitionImage(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-	Image::copyImageOnGPU(cmd, _drawImage, _swapchain.image(_swapchain.imageIndex()));
-
-	// Transition swapchain image to a presentation-ready layout
-	_swapchain.image(_swapchain.imageIndex()).transitionImage(cmd, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	// The graph records each pass after the barriers it needs, and leaves the swapchain image ready for presentation
+	_renderGraph.compile();
+	_renderGraph.execute(cmd);
 
+	gpuTimer.endZone(cmd, frameZone);
 	cmd.end();
-	cmd.submitToQueue(_device.graphicsQueue(), getCurrentFrame()); // Submit the command buffer
-	_swapchain.presentToScreen(_device.presentQueue(), getCurrentFrame(), _swapchain.imageIndex()); // Present to screen
+	recordZone.end();
+	recordPhase.end();
+
+	{
+		PROFILE_ZONE("Submit");
+		PROFILE_MARKER("Queue Submit");
+		cmd.submitToQueue(_device.graphicsQueue(), getCurrentFrame()); // Submit the command buffer
+	}
+	{
+		PROFILE_ZONE("Present");
+		FramePhaseTimer phase(frameStatistics, FramePhase::present);
+		_swapchain.presentToScreen(_device.presentQueue(), getCurrentFrame(), _swapchain.imageIndex()); // Present to screen
+	}
 	
 	_frameNumber++;
+	_uploadHeap.nextFrame();
 }
 
 void Renderer::resizeCallback() {
 	if (_swapchain.resizeRequested()) {
 		_swapchain.recreate();
-		_drawImage.recreate({ _window.extent().width, _window.extent().height, 1 });
+		if (_rendersOffscreen) {
+			_drawImage.recreate({ _window.extent().width, _window.extent().height, 1 });
+		}
 		_aspectRatio = float(_window.extent().width) / float(_window.extent().height);
 	}
 }
 
+void Renderer::retirePipeline(Pipeline&& pipeline) {
+	_retiredPipelines.emplace_back(_frameNumber, std::move(pipeline));
+}
+
 void Renderer::waitForIdle() {
 	vkDeviceWaitIdle(_device.device());
 }
\ No newline at end of file
@@ -1,37 +1,49 @@
 #include "renderer/shader.h"
+#include "utility/mapped_file.h"
 
 Shader::Shader(const Device& device, const std::string& filepath, VkShaderStageFlagBits stageFlag)
 	: _device(device),
+	_shaderModule(VK_NULL_HANDLE),
 	_shaderStageFlag(stageFlag) {
-	// std::ios::ate -> puts stream curser at end
-	// std::ios::binary -> opens file in binary mode
-	std::ifstream file(filepath, std::ios::ate | std::ios::binary);
-	if (!file.is_open()) {
-		std::stringstream line;
-		line << "ERROR: Shader file does not exist: " << filepath << std::endl;
-		throw std::runtime_error(line.str());
+	MappedFile file = [&filepath]() {
+		try {
+			return MappedFile(filepath);
+		}
+		catch (const std::exception&) {
+			std::stringstream line;
+			line << "ERROR: Shader file does not exist: " << filepath << std::endl;
+			throw std::runtime_error(line.str());
+		}
+	}();
+	// Mappings are page aligned, so the words can be handed to Vulkan in place
+	createModule(reinterpret_cast<const uint32_t*>(file.data()), file.size(), filepath);
+	std::cout << "Shader successfully loaded: " << filepath << std::endl;
+}
+
+Shader::Shader(const Device& device, const uint32_t* code, size_t codeSize, VkShaderStageFlagBits stageFlag, const std::string& name)
+	: _device(device),
+	_shaderModule(VK_NULL_HANDLE),
+	_shaderStageFlag(stageFlag) {
+	createModule(code, codeSize, name);
+}
+
+void Shader::createModule(const uint32_t* code, size_t codeSize, const std::string& name) {
+	if (codeSize == 0 || codeSize % sizeof(uint32_t) != 0) {
+		throw std::runtime_error("Shader is not valid SPIR-V (its size isn't a whole number of words): " + name);
 	}
-	// Since cursor is at the end, use it to find the size of the file, then copy the entire shader into a vector of uint32_t
-	size_t filesize = (size_t)file.tellg(); // tellg() returns the position of the cursor
-	std::vector<uint32_t> buffer(filesize / sizeof(uint32_t));
-	file.seekg(0); // move cursor to beginning
-	file.read((char*)buffer.data(), filesize); // load entire file into the buffer
-	file.close();
-	// Now we have the entire shader in the buffer and can load it to Vulkan
 	VkShaderModuleCreateInfo createinfo{
 	.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
 	.pNext = nullptr,
 	.flags = 0,
-	.codeSize = buffer.size() * sizeof(uint32_t), // codeSize has to be in byte
-	.pCode = buffer.data()
+	.codeSize = codeSize, // codeSize has to be in byte
+	.pCode = code
 	};
 
-	if (vkCreateShaderModule(device.device(), &createinfo, nullptr, &_shaderModule) != VK_SUCCESS) {
+	if (vkCreateShaderModule(_device.device(), &createinfo, nullptr, &_shaderModule) != VK_SUCCESS) {
 		std::stringstream line;
-		line << "Error: vkCreateShaderModule() failed while creating " << filepath << std::endl;
+		line << "Error: vkCreateShaderModule() failed while creating " << name << std::endl;
 		throw std::runtime_error(line.str());
 	}
-	std::cout << "Shader successfully loaded: " << filepath << std::endl;
 }
 
 Shader::~Shader() {
@@ -0,0 +1,99 @@
+#include "renderer/shader_hot_reloader.h"
+#include "utility/logger.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+
+ShaderHotReloader::ShaderHotReloader(const std::string& compiler) : _compiler(compiler), _nextListenerId(0) {}
+
+ShaderHotReloader::~ShaderHotReloader() {
+	for (Compile& compile : _compiles) {
+		compile.exitCode.wait();
+	}
+}
+
+std::string ShaderHotReloader::defaultCompiler() {
+#ifdef GLSL_VALIDATOR_PATH
+	return GLSL_VALIDATOR_PATH;
+#else
+	return "glslangValidator";
+#endif
+}
+
+bool ShaderHotReloader::isGlslSource(const std::string& path) {
+	std::string extension = std::filesystem::path(path).extension().string();
+	return extension == ".vert" || extension == ".frag" || extension == ".comp";
+}
+
+void ShaderHotReloader::watch(const std::string& directory) {
+	_watcher.watchDirectory(directory);
+	Logger::getLogger().print("Hot reloading shaders in " + directory);
+}
+
+uint32_t ShaderHotReloader::addListener(const std::vector<std::string>& spirvPaths, std::function<void()> callback) {
+	Listener listener{ _nextListenerId++, {}, std::move(callback) };
+	for (const std::string& path : spirvPaths) {
+		listener.spirvPaths.push_back(FileWatcher::normalize(path));
+	}
+	_listeners.push_back(std::move(listener));
+	return _listeners.back().id;
+}
+
+void ShaderHotReloader::removeListener(uint32_t id) {
+	std::erase_if(_listeners, [id](const Listener& listener) { return listener.id == id; });
+}
+
+void ShaderHotReloader::compile(const std::string& source) {
+	auto running = std::find_if(_compiles.begin(), _compiles.end(), [&source](const Compile& compile) { return compile.source == source; });
+	if (running != _compiles.end()) {
+		// Two compiles of one source would write the same output concurrently
+		running->sourceChangedAgain = true;
+		return;
+	}
+
+	std::string command = "\"" + _compiler + "\" -V \"" + source + "\" -o \"" + source + ".spv\"";
+#ifdef _WIN32
+	command = "\"" + command + "\""; // cmd.exe strips the outer quotes of a command starting with a quoted path
+#endif
+	Logger::getLogger().print("Compiling " + source);
+	_compiles.push_back(Compile{ source, std::async(std::launch::async, [command]() { return std::system(command.c_str()); }), false });
+}
+
+void ShaderHotReloader::update() {
+	static Logger& logger = Logger::getLogger();
+	if (!_watcher.watching()) return;
+
+	std::vector<std::string> changedSpirv;
+	for (const std::string& path : _watcher.changedFiles()) {
+		if (isGlslSource(path)) {
+			compile(path);
+		}
+		else {
+			changedSpirv.push_back(path);
+		}
+	}
+
+	// The compiler's output is printed to the console. On success the .spv it writes is picked up by the watcher on a later frame
+	std::vector<std::string> recompile;
+	std::erase_if(_compiles, [&recompile](Compile& compile) {
+		if (compile.exitCode.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+		int exitCode = compile.exitCode.get();
+		logger.print(exitCode == 0 ? "Compiled " + compile.source : "Failed to compile " + compile.source + ", keeping the previous pipeline");
+		if (compile.sourceChangedAgain) {
+			recompile.push_back(compile.source);
+		}
+		return true;
+	});
+	for (const std::string& source : recompile) {
+		compile(source);
+	}
+
+	for (Listener& listener : _listeners) {
+		bool affected = std::any_of(listener.spirvPaths.begin(), listener.spirvPaths.end(), [&changedSpirv](const std::string& path) {
+			return std::find(changedSpirv.begin(), changedSpirv.end(), path) != changedSpirv.end();
+		});
+		if (affected) {
+			listener.callback();
+		}
+	}
+}
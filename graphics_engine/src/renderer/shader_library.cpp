@@ -0,0 +1,63 @@
+#include "renderer/shader_library.h"
+#include "renderer/device.h"
+#include "utility/logger.h"
+#include "utility/mapped_file.h"
+#include <stdexcept>
+
+ShaderLibrary::ShaderLibrary(const Device& device) : _device(device), _requests(0), _modulesCreated(0) {}
+
+uint64_t ShaderLibrary::contentHash(const void* data, size_t size) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::shared_ptr<Shader> ShaderLibrary::load(const std::string& path, VkShaderStageFlagBits stage) {
+	static Logger& logger = Logger::getLogger();
+
+	// Map and hash outside the lock, only the lookup and the module creation are serialized
+	MappedFile file = [&path]() {
+		try {
+			return MappedFile(path);
+		}
+		catch (const std::exception&) {
+			throw std::runtime_error("ERROR: Shader file does not exist: " + path);
+		}
+	}();
+	ShaderKey key{ contentHash(file.data(), file.size()), stage };
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_requests++;
+	_pathHashes[path] = key.hash;
+	auto found = _shaders.find(key);
+	if (found != _shaders.end()) {
+		return found->second;
+	}
+
+	// Mappings are page aligned, so the words can be handed to Vulkan in place
+	auto shader = std::make_shared<Shader>(_device, reinterpret_cast<const uint32_t*>(file.data()), file.size(), stage, path);
+	_shaders.emplace(key, shader);
+	_modulesCreated++;
+	logger.print("Shader successfully loaded: " + path);
+	return shader;
+}
+
+uint64_t ShaderLibrary::loadedHash(const std::string& path) const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto found = _pathHashes.find(path);
+	return found != _pathHashes.end() ? found->second : 0;
+}
+
+void ShaderLibrary::trim() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	std::erase_if(_shaders, [](const auto& entry) { return entry.second.use_count() == 1; });
+}
+
+ShaderLibraryStatistics ShaderLibrary::statistics() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return ShaderLibraryStatistics{ _requests, _modulesCreated, static_cast<uint32_t>(_shaders.size()) };
+}
@@ -0,0 +1,75 @@
+#include "renderer/upload_heap.h"
+#include "renderer/descriptor.h"
+#include "renderer/device.h"
+#include "utility/allocator.h"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+UploadHeap::UploadHeap(const Device& device, const Allocator& allocator, DescriptorLayoutCache& layoutCache, DescriptorAllocator& descriptorAllocator,
+	uint32_t framesInFlight, size_t bytesPerFrame) :
+	_layout(VK_NULL_HANDLE),
+	_set(VK_NULL_HANDLE),
+	_regions(framesInFlight + 1),
+	_region(0),
+	_regionStart(0),
+	_offset(0) {
+
+	const VkPhysicalDeviceLimits limits = device.physicalDeviceProperies().limits;
+	_alignment = std::max<size_t>(limits.minUniformBufferOffsetAlignment, 1);
+	_bytesPerFrame = (bytesPerFrame + _alignment - 1) & ~(_alignment - 1);
+	_range = std::min<size_t>({ limits.maxUniformBufferRange, 64 * 1024, _bytesPerFrame });
+
+	// An allocation at the very end of the last region is still viewed by a whole range, so the buffer has one range of padding
+	size_t bufferSize = _regions * _bytesPerFrame + _range;
+	_buffer = std::make_unique<Buffer>(device, allocator, bufferSize, 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	_buffer->map();
+
+	std::array<VkDescriptorSetLayoutBinding, dynamicBindings> bindings{};
+	for (uint32_t i = 0; i < dynamicBindings; i++) {
+		bindings[i] = VkDescriptorSetLayoutBinding{ i, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+	}
+	_layout = layoutCache.get(bindings);
+	_set = descriptorAllocator.allocate(_layout, layoutCache.bindings(_layout));
+
+	// Every binding views the same range from the start of the buffer, the dynamic offsets place them
+	VkDescriptorBufferInfo bufferInfo{ .buffer = _buffer->buffer(), .offset = 0, .range = _range };
+	std::array<VkWriteDescriptorSet, dynamicBindings> writes{};
+	for (uint32_t i = 0; i < dynamicBindings; i++) {
+		writes[i] = VkWriteDescriptorSet{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext = nullptr,
+			.dstSet = _set,
+			.dstBinding = i,
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+			.pBufferInfo = &bufferInfo
+		};
+	}
+	vkUpdateDescriptorSets(device.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+UploadAllocation UploadHeap::allocate(size_t size) {
+	if (size > _range) {
+		throw std::runtime_error("Upload heap allocation of " + std::to_string(size) + " bytes is larger than a binding's range of " + std::to_string(_range));
+	}
+	size_t offset = (_offset + _alignment - 1) & ~(_alignment - 1);
+	if (offset + size > _regionStart + _bytesPerFrame) {
+		throw std::runtime_error("Upload heap is out of space for this frame (" + std::to_string(_bytesPerFrame) + " bytes per frame)");
+	}
+	_offset = offset + size;
+	return UploadAllocation{ static_cast<std::byte*>(_buffer->mappedData()) + offset, static_cast<uint32_t>(offset) };
+}
+
+void UploadHeap::nextFrame() {
+	_region = (_region + 1) % _regions;
+	_regionStart = _region * _bytesPerFrame;
+	_offset = _regionStart;
+}
+
+void UploadHeap::bind(Command& cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set, std::span<const uint32_t> offsets) const {
+	std::array<uint32_t, dynamicBindings> dynamicOffsets{};
+	std::copy_n(offsets.begin(), std::min<size_t>(offsets.size(), dynamicBindings), dynamicOffsets.begin());
+	vkCmdBindDescriptorSets(cmd.buffer(), bindPoint, layout, set, 1, &_set, dynamicBindings, dynamicOffsets.data());
+}
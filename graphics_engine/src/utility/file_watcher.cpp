@@ -0,0 +1,114 @@
+#include "utility/file_watcher.h"
+#include "utility/logger.h"
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher() : _inotify(-1), _lastPoll() {
+#ifdef __linux__
+	_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_inotify < 0) {
+		Logger::getLogger().print("inotify is unavailable, watched directories will be polled");
+	}
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+	if (_inotify >= 0) {
+		close(_inotify); // Also removes every watch
+	}
+#endif
+}
+
+std::string FileWatcher::normalize(const std::filesystem::path& path) {
+	return path.lexically_normal().make_preferred().string();
+}
+
+void FileWatcher::watchDirectory(const std::string& directory) {
+	std::error_code error;
+	if (!std::filesystem::is_directory(directory, error)) {
+		throw std::runtime_error("Can't watch " + directory + ": not a directory");
+	}
+
+	WatchedDirectory watched{ std::filesystem::path(directory), -1, {} };
+#ifdef __linux__
+	if (_inotify >= 0) {
+		// Close-after-write rather than every write, so a file is reported once it is complete. Editors and compilers that write a
+		// temporary file and rename it over the original show up as a move
+		watched.watch = inotify_add_watch(_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	}
+#endif
+	if (watched.watch < 0) {
+		// Record the current times, so only later writes are reported
+		std::vector<std::string> ignored;
+		pollDirectory(watched, ignored);
+	}
+	_directories.push_back(std::move(watched));
+}
+
+std::vector<std::string> FileWatcher::changedFiles() {
+	std::vector<std::string> changed;
+	if (_directories.empty()) return changed;
+
+	readEvents(changed);
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - _lastPoll >= pollInterval) {
+		_lastPoll = now;
+		for (WatchedDirectory& directory : _directories) {
+			if (directory.watch < 0) {
+				pollDirectory(directory, changed);
+			}
+		}
+	}
+
+	// A file saved twice between two calls is one change
+	std::sort(changed.begin(), changed.end());
+	changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+	return changed;
+}
+
+void FileWatcher::readEvents(std::vector<std::string>& changed) {
+#ifdef __linux__
+	if (_inotify < 0) return;
+
+	alignas(inotify_event) char buffer[4096];
+	ssize_t length;
+	while ((length = read(_inotify, buffer, sizeof(buffer))) > 0) {
+		for (char* next = buffer; next < buffer + length;) {
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(next);
+			next += sizeof(inotify_event) + event->len;
+			if (event->len == 0) continue; // Event on the directory itself
+
+			auto directory = std::find_if(_directories.begin(), _directories.end(), [event](const WatchedDirectory& watched) { return watched.watch == event->wd; });
+			if (directory != _directories.end()) {
+				changed.push_back(normalize(directory->path / event->name));
+			}
+		}
+	}
+#else
+	(void)changed;
+#endif
+}
+
+void FileWatcher::pollDirectory(WatchedDirectory& directory, std::vector<std::string>& changed) {
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory.path, error)) {
+		if (!entry.is_regular_file(error)) continue;
+
+		std::filesystem::file_time_type writeTime = entry.last_write_time(error);
+		if (error) continue; // Removed or replaced while iterating, the next poll sees it
+
+		std::string path = normalize(entry.path());
+		auto known = directory.writeTimes.find(path);
+		if (known == directory.writeTimes.end() || known->second != writeTime) {
+			directory.writeTimes[path] = writeTime;
+			changed.push_back(path);
+		}
+	}
+}
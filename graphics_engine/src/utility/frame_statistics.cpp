@@ -0,0 +1,112 @@
+#include "utility/frame_statistics.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+FrameStatistics::FrameStatistics() :
+	_window(windowSize),
+	_next(0),
+	_samples(0),
+	_currentPhases{},
+	_histogram{},
+	_histogramBinWidth(1.0),
+	_budgetMilliseconds(1000.0 / 60.0),
+	_overBudgetFrames(0),
+	_totalFrames(0) {}
+
+const char* FrameStatistics::phaseName(FramePhase phase) {
+	switch (phase) {
+	case FramePhase::cpuSim: return "CPU Sim";
+	case FramePhase::cpuRecord: return "CPU Record";
+	case FramePhase::fenceWait: return "Fence Wait";
+	case FramePhase::present: return "Present";
+	default: return "Unknown";
+	}
+}
+
+void FrameStatistics::recordPhase(FramePhase phase, double milliseconds) {
+	_currentPhases[static_cast<int>(phase)] += milliseconds;
+}
+
+void FrameStatistics::endFrame(double frameMilliseconds) {
+	_window[_next] = FrameSample{ _totalFrames, frameMilliseconds, _currentPhases };
+	_next = (_next + 1) % windowSize;
+	_samples = std::min(_samples + 1, windowSize);
+	_currentPhases.fill(0.0);
+
+	int bin = std::min(static_cast<int>(frameMilliseconds / _histogramBinWidth), histogramBins - 1);
+	_histogram[std::max(bin, 0)]++;
+	if (frameMilliseconds > _budgetMilliseconds) {
+		_overBudgetFrames++;
+	}
+	_totalFrames++;
+}
+
+void FrameStatistics::reset() {
+	_next = 0;
+	_samples = 0;
+	_currentPhases.fill(0.0);
+	_histogram.fill(0);
+	_overBudgetFrames = 0;
+	_totalFrames = 0;
+}
+
+template<typename Selector>
+double FrameStatistics::windowPercentile(double p, Selector value) const {
+	if (_samples == 0) return 0.0;
+
+	std::vector<double> values;
+	values.reserve(_samples);
+	for (int i = 0; i < _samples; i++) {
+		values.push_back(value(_window[i]));
+	}
+
+	// Nearest-rank percentile
+	size_t rank = static_cast<size_t>(std::clamp(p, 0.0, 100.0) / 100.0 * (values.size() - 1) + 0.5);
+	std::nth_element(values.begin(), values.begin() + rank, values.end());
+	return values[rank];
+}
+
+double FrameStatistics::percentile(double p) const {
+	return windowPercentile(p, [](const FrameSample& sample) { return sample.frameMilliseconds; });
+}
+
+double FrameStatistics::phasePercentile(FramePhase phase, double p) const {
+	int index = static_cast<int>(phase);
+	return windowPercentile(p, [index](const FrameSample& sample) { return sample.phaseMilliseconds[index]; });
+}
+
+double FrameStatistics::phaseMean(FramePhase phase) const {
+	if (_samples == 0) return 0.0;
+	double sum = 0.0;
+	for (int i = 0; i < _samples; i++) {
+		sum += _window[i].phaseMilliseconds[static_cast<int>(phase)];
+	}
+	return sum / _samples;
+}
+
+bool FrameStatistics::exportCsv(const std::string& path) const {
+	std::ofstream file(path);
+	if (!file) return false;
+
+	file << "frame,frame_ms";
+	for (int phase = 0; phase < phaseCount; phase++) {
+		std::string name = phaseName(static_cast<FramePhase>(phase));
+		std::replace(name.begin(), name.end(), ' ', '_');
+		std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		file << "," << name << "_ms";
+	}
+	file << "\n";
+
+	// Oldest frame first
+	int oldest = _samples < windowSize ? 0 : _next;
+	for (int i = 0; i < _samples; i++) {
+		const FrameSample& sample = _window[(oldest + i) % windowSize];
+		file << sample.frame << "," << sample.frameMilliseconds;
+		for (double milliseconds : sample.phaseMilliseconds) {
+			file << "," << milliseconds;
+		}
+		file << "\n";
+	}
+	return static_cast<bool>(file);
+}
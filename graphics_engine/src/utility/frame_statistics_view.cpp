@@ -0,0 +1,59 @@
+#include "utility/frame_statistics.h"
+#include "utility/gui.h"
+
+// ImGui view of the frame statistics. Kept apart from the bookkeeping, which has no dependency on ImGui or the renderer
+
+void FrameStatistics::addWidgets() {
+	Gui::getGui().addWidget("Frame Statistics", [this]() {
+		ImGui::Text("Frames: %llu, over budget: %llu (%.2f%%)", static_cast<unsigned long long>(_totalFrames),
+			static_cast<unsigned long long>(_overBudgetFrames), _totalFrames > 0 ? 100.0 * _overBudgetFrames / _totalFrames : 0.0);
+
+		float budget = static_cast<float>(_budgetMilliseconds);
+		if (ImGui::DragFloat("Budget (ms)", &budget, 0.01f, 1.0f, 1000.0f)) {
+			setBudget(budget);
+		}
+
+		if (ImGui::BeginTable("Frame Percentiles", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+			ImGui::TableSetupColumn("");
+			ImGui::TableSetupColumn("Mean / p50");
+			ImGui::TableSetupColumn("p95");
+			ImGui::TableSetupColumn("p99");
+			ImGui::TableSetupColumn("Max");
+			ImGui::TableHeadersRow();
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::TextUnformatted("Frame");
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", percentile(50.0));
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", percentile(95.0));
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", percentile(99.0));
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", percentile(100.0));
+			for (int phase = 0; phase < phaseCount; phase++) {
+				FramePhase framePhase = static_cast<FramePhase>(phase);
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::TextUnformatted(phaseName(framePhase));
+				ImGui::TableNextColumn(); ImGui::Text("%.3f / %.3f", phaseMean(framePhase), phasePercentile(framePhase, 50.0));
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", phasePercentile(framePhase, 95.0));
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", phasePercentile(framePhase, 99.0));
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", phasePercentile(framePhase, 100.0));
+			}
+			ImGui::EndTable();
+		}
+
+		// PlotHistogram takes floats
+		float bins[histogramBins];
+		for (int i = 0; i < histogramBins; i++) {
+			bins[i] = static_cast<float>(_histogram[i]);
+		}
+		ImGui::PlotHistogram("Frame Times", bins, histogramBins, 0, "0 - 50 ms", 0.0f, FLT_MAX, ImVec2(0.0f, 80.0f));
+
+		if (ImGui::Button("Export CSV")) {
+			std::string path = "frame_statistics_" + std::to_string(_totalFrames) + ".csv";
+			_exportStatus = exportCsv(path) ? "Exported " + path : "Failed to export " + path;
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Reset")) {
+			reset();
+		}
+		ImGui::TextUnformatted(_exportStatus.c_str());
+	});
+}
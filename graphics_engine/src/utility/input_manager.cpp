@@ -70,12 +70,18 @@ void InputManager::processInputs() {
 			case SDLK_RIGHT:
 				dispatchEvent(InputEvent::rightArrowDown);
 				break;
+			case SDLK_F9:
+				dispatchEvent(InputEvent::f9Down);
+				break;
 			default:
 				break;
 			}
 			break;
 		case SDL_KEYUP:
 			switch (sdl_event.key.keysym.sym) {
+			case SDLK_F9:
+				dispatchEvent(InputEvent::f9Up);
+				break;
 			default:
 				break;
 			}
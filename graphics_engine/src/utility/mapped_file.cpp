@@ -0,0 +1,124 @@
+#include "utility/mapped_file.h"
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path) : _path(path), _data(nullptr), _size(0), _file(INVALID_HANDLE_VALUE), _mapping(nullptr) {
+	_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (_file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open file for mapping: " + path);
+	}
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(_file, &size)) {
+		cleanup();
+		throw std::runtime_error("Failed to get the size of file: " + path);
+	}
+	_size = static_cast<size_t>(size.QuadPart);
+	// Empty files can't be mapped, they are just an empty range
+	if (_size == 0) return;
+
+	_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!_mapping) {
+		cleanup();
+		throw std::runtime_error("Failed to create file mapping: " + path);
+	}
+	_data = static_cast<const std::byte*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!_data) {
+		cleanup();
+		throw std::runtime_error("Failed to map view of file: " + path);
+	}
+}
+
+void MappedFile::cleanup() {
+	if (_data) UnmapViewOfFile(_data);
+	if (_mapping) CloseHandle(_mapping);
+	if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+	_data = nullptr;
+	_mapping = nullptr;
+	_file = INVALID_HANDLE_VALUE;
+	_size = 0;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+	_path(std::move(other._path)),
+	_data(std::exchange(other._data, nullptr)),
+	_size(std::exchange(other._size, 0)),
+	_file(std::exchange(other._file, INVALID_HANDLE_VALUE)),
+	_mapping(std::exchange(other._mapping, nullptr)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		cleanup();
+		_path = std::move(other._path);
+		_data = std::exchange(other._data, nullptr);
+		_size = std::exchange(other._size, 0);
+		_file = std::exchange(other._file, INVALID_HANDLE_VALUE);
+		_mapping = std::exchange(other._mapping, nullptr);
+	}
+	return *this;
+}
+#else
+MappedFile::MappedFile(const std::string& path) : _path(path), _data(nullptr), _size(0), _file(-1) {
+	_file = open(path.c_str(), O_RDONLY);
+	if (_file < 0) {
+		throw std::runtime_error("Failed to open file for mapping: " + path);
+	}
+
+	struct stat status {};
+	if (fstat(_file, &status) != 0) {
+		cleanup();
+		throw std::runtime_error("Failed to get the size of file: " + path);
+	}
+	_size = static_cast<size_t>(status.st_size);
+	// Empty files can't be mapped, they are just an empty range
+	if (_size == 0) return;
+
+	void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _file, 0);
+	if (data == MAP_FAILED) {
+		cleanup();
+		throw std::runtime_error("Failed to map file: " + path);
+	}
+	_data = static_cast<const std::byte*>(data);
+}
+
+void MappedFile::cleanup() {
+	if (_data) munmap(const_cast<std::byte*>(_data), _size);
+	if (_file >= 0) close(_file);
+	_data = nullptr;
+	_file = -1;
+	_size = 0;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+	_path(std::move(other._path)),
+	_data(std::exchange(other._data, nullptr)),
+	_size(std::exchange(other._size, 0)),
+	_file(std::exchange(other._file, -1)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		cleanup();
+		_path = std::move(other._path);
+		_data = std::exchange(other._data, nullptr);
+		_size = std::exchange(other._size, 0);
+		_file = std::exchange(other._file, -1);
+	}
+	return *this;
+}
+#endif
+
+MappedFile::~MappedFile() {
+	cleanup();
+}
@@ -0,0 +1,282 @@
+#include "utility/profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+// @brief Returns the calling thread's buffer to the profiler when the thread exits
+struct ProfileThreadSlot {
+	ProfileEventBuffer* buffer = nullptr;
+
+	~ProfileThreadSlot() {
+		if (buffer) {
+			Profiler::getProfiler().releaseBuffer(buffer);
+		}
+	}
+};
+
+static thread_local ProfileThreadSlot threadSlot;
+static thread_local uint32_t zoneDepth = 0; // Zones currently open on this thread
+
+// ----------------------------------------------- EVENT BUFFER --------------------------------------------- //
+
+void ProfileEventBuffer::drain(std::vector<ProfileRecord>& records) {
+	uint64_t head = _head.load(std::memory_order_acquire);
+	uint64_t tail = _tail.load(std::memory_order_relaxed);
+	for (; tail < head; tail++) {
+		records.push_back(ProfileRecord{ _events[tail & (capacity - 1)], _lane });
+	}
+	_tail.store(head, std::memory_order_release);
+}
+
+// ----------------------------------------------- STATISTICS --------------------------------------------- //
+
+void ZoneStatistics::add(double milliseconds) {
+	history[next] = milliseconds;
+	next = (next + 1) % historySize;
+	samples = std::min(samples + 1, historySize);
+}
+
+double ZoneStatistics::last() const {
+	return samples > 0 ? history[(next + historySize - 1) % historySize] : 0.0;
+}
+
+double ZoneStatistics::mean() const {
+	if (samples == 0) return 0.0;
+	double sum = 0.0;
+	for (int i = 0; i < samples; i++) sum += history[i];
+	return sum / samples;
+}
+
+double ZoneStatistics::max() const {
+	double result = 0.0;
+	for (int i = 0; i < samples; i++) result = std::max(result, history[i]);
+	return result;
+}
+
+// ----------------------------------------------- PROFILER --------------------------------------------- //
+
+Profiler::Profiler() : _epoch(std::chrono::steady_clock::now()) {}
+
+ProfileEventBuffer& Profiler::threadBuffer() {
+	if (threadSlot.buffer) {
+		return *threadSlot.buffer;
+	}
+
+	std::lock_guard<std::mutex> lock(_registryMutex);
+	if (!_freeBuffers.empty()) {
+		// The previous owner has exited, so this thread becomes the buffer's only producer
+		threadSlot.buffer = _freeBuffers.back();
+		_freeBuffers.pop_back();
+	}
+	else {
+		uint32_t lane = static_cast<uint32_t>(_buffers.size());
+		_buffers.push_back(std::make_unique<ProfileEventBuffer>(lane));
+		_laneNames.push_back("Thread " + std::to_string(lane));
+		threadSlot.buffer = _buffers.back().get();
+	}
+	return *threadSlot.buffer;
+}
+
+void Profiler::releaseBuffer(ProfileEventBuffer* buffer) {
+	std::lock_guard<std::mutex> lock(_registryMutex);
+	_freeBuffers.push_back(buffer);
+}
+
+void Profiler::setThreadName(const std::string& name) {
+	uint32_t lane = threadBuffer().lane();
+	std::lock_guard<std::mutex> lock(_registryMutex);
+	_laneNames[lane] = name;
+}
+
+std::string Profiler::laneName(uint32_t lane) {
+	std::lock_guard<std::mutex> lock(_registryMutex);
+	return lane < _laneNames.size() ? _laneNames[lane] : "Unknown";
+}
+
+uint64_t Profiler::droppedEvents() {
+	std::lock_guard<std::mutex> lock(_registryMutex);
+	uint64_t dropped = 0;
+	for (auto& buffer : _buffers) {
+		dropped += buffer->dropped();
+	}
+	return dropped;
+}
+
+void Profiler::marker(const char* name) {
+	if (!enabled()) return;
+	uint64_t time = now();
+	threadBuffer().push(ProfileEvent{ name, time, time, zoneDepth, true });
+}
+
+void Profiler::recordGpuTime(const char* name, double milliseconds) {
+	if (!enabled()) return;
+	_gpuTimes.emplace_back(name, milliseconds);
+}
+
+void Profiler::newFrame() {
+	uint64_t frameEnd = now();
+
+	// The lock only guards the list of buffers against threads registering, the buffers themselves are drained lock-free
+	_collected.clear();
+	{
+		std::lock_guard<std::mutex> lock(_registryMutex);
+		for (auto& buffer : _buffers) {
+			buffer->drain(_collected);
+		}
+	}
+
+	// Sum the time spent in each zone over every thread. Zones are keyed by their literal's address first to avoid a string per event
+	std::unordered_map<const char*, std::pair<double, uint32_t>> frameTotals;
+	for (const ProfileRecord& record : _collected) {
+		if (record.event.instant) continue;
+		auto& [milliseconds, calls] = frameTotals[record.event.name];
+		milliseconds += (record.event.end - record.event.start) * 1e-6;
+		calls++;
+	}
+
+	std::unordered_map<std::string, std::pair<double, uint32_t>> namedTotals;
+	for (auto& [name, total] : frameTotals) {
+		auto& namedTotal = namedTotals[name];
+		namedTotal.first += total.first;
+		namedTotal.second += total.second;
+	}
+	for (auto& [name, milliseconds] : _gpuTimes) {
+		auto& namedTotal = namedTotals[std::string("GPU ") + name];
+		namedTotal.first += milliseconds;
+		namedTotal.second++;
+	}
+	_gpuTimes.clear();
+
+	for (auto& [name, total] : namedTotals) {
+		_statistics[name]; // Make sure zones seen for the first time get an entry
+	}
+	// Zones that didn't run this frame still advance, so their rolling window covers the same frames as everyone else's
+	for (auto& [name, statistics] : _statistics) {
+		auto total = namedTotals.find(name);
+		statistics.add(total != namedTotals.end() ? total->second.first : 0.0);
+		statistics.calls = total != namedTotals.end() ? total->second.second : 0;
+	}
+
+	if (_captureFramesLeft > 0) {
+		_captureRecords.insert(_captureRecords.end(), _collected.begin(), _collected.end());
+		_captureFrames.push_back(CapturedFrame{ _frameNumber, _currentFrameStart, frameEnd });
+		if (--_captureFramesLeft == 0) {
+			writeCapture();
+		}
+	}
+
+	if (!_freezeView) {
+		_lastFrame.swap(_collected);
+		_lastFrameStart = _currentFrameStart;
+		_lastFrameEnd = frameEnd;
+	}
+	_currentFrameStart = frameEnd;
+	_frameNumber++;
+}
+
+// ----------------------------------------------- CAPTURE --------------------------------------------- //
+
+void Profiler::startCapture(int numFrames, const std::string& path) {
+	if (capturing() || numFrames <= 0) return;
+
+	_capturePath = path;
+	_captureFramesLeft = numFrames;
+	_captureRecords.clear();
+	_captureFrames.clear();
+}
+
+// @brief Escapes the characters that can't appear as-is in a JSON string
+static std::string escapeJson(const char* text) {
+	std::string escaped;
+	for (const char* c = text; *c; c++) {
+		switch (*c) {
+		case '"': escaped += "\\\""; break;
+		case '\\': escaped += "\\\\"; break;
+		case '\n': escaped += "\\n"; break;
+		default:
+			if (static_cast<unsigned char>(*c) < 0x20) continue;
+			escaped += *c;
+		}
+	}
+	return escaped;
+}
+
+void Profiler::writeCapture() {
+	std::ofstream file(_capturePath);
+	if (!file) {
+		std::cerr << "Failed to open profiler capture file " << _capturePath << std::endl;
+		_captureRecords.clear();
+		_captureFrames.clear();
+		return;
+	}
+
+	// Trace event timestamps are microseconds
+	auto microseconds = [](uint64_t nanoseconds) { return nanoseconds / 1000.0; };
+	file.precision(3);
+	file << std::fixed;
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Engine\"}}";
+
+	// Name every lane that recorded something, so worker batches show up as separate tracks
+	uint32_t numLanes = 0;
+	for (const ProfileRecord& record : _captureRecords) {
+		numLanes = std::max(numLanes, record.lane + 1);
+	}
+	for (uint32_t lane = 0; lane < numLanes; lane++) {
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << lane << ",\"args\":{\"name\":\"" << escapeJson(laneName(lane).c_str()) << "\"}}";
+	}
+
+	// Frame boundaries are global instant events, plus a zone per frame on its own track
+	uint32_t frameTrack = numLanes;
+	file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << frameTrack << ",\"args\":{\"name\":\"Frames\"}}";
+	for (const CapturedFrame& frame : _captureFrames) {
+		file << ",\n{\"name\":\"Frame " << frame.number << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << frameTrack
+			<< ",\"ts\":" << microseconds(frame.start) << ",\"dur\":" << microseconds(frame.end - frame.start) << "}";
+		file << ",\n{\"name\":\"Frame Boundary\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":" << frameTrack
+			<< ",\"ts\":" << microseconds(frame.end) << "}";
+	}
+
+	for (const ProfileRecord& record : _captureRecords) {
+		const ProfileEvent& event = record.event;
+		if (event.instant) {
+			file << ",\n{\"name\":\"" << escapeJson(event.name) << "\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" << record.lane
+				<< ",\"ts\":" << microseconds(event.start) << "}";
+		}
+		else {
+			file << ",\n{\"name\":\"" << escapeJson(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << record.lane
+				<< ",\"ts\":" << microseconds(event.start) << ",\"dur\":" << microseconds(event.end - event.start) << "}";
+		}
+	}
+	file << "\n]}\n";
+
+	_lastCapturePath = _capturePath;
+	_captureRecords.clear();
+	_captureFrames.clear();
+}
+
+// ----------------------------------------------- ZONE --------------------------------------------- //
+
+ProfileZone::ProfileZone(const char* name) :
+	_name(name),
+	_start(0),
+	_depth(zoneDepth),
+	_active(Profiler::getProfiler().enabled()) {
+	if (_active) {
+		zoneDepth++;
+		_start = Profiler::getProfiler().now();
+	}
+}
+
+ProfileZone::~ProfileZone() {
+	end();
+}
+
+void ProfileZone::end() {
+	if (!_active) return;
+	_active = false;
+
+	Profiler& profiler = Profiler::getProfiler();
+	uint64_t endTime = profiler.now();
+	zoneDepth--;
+	profiler.threadBuffer().push(ProfileEvent{ _name, _start, endTime, _depth, false });
+}
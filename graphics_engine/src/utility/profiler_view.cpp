@@ -0,0 +1,144 @@
+#include "utility/profiler.h"
+#include "utility/gui.h"
+#include <algorithm>
+#include <functional>
+#include <string_view>
+
+// ImGui views of the profiler. Kept apart from the recording code, which has no dependency on ImGui or the renderer
+
+static const float rowHeight = 18.0f;
+static const float lanePadding = 6.0f;
+
+// @brief A stable color per zone name, so the same zone keeps its color from frame to frame
+static ImU32 zoneColor(const char* name) {
+	size_t hash = std::hash<std::string_view>{}(name);
+	int r = 90 + static_cast<int>(hash & 0x7F);
+	int g = 90 + static_cast<int>((hash >> 8) & 0x7F);
+	int b = 90 + static_cast<int>((hash >> 16) & 0x7F);
+	return IM_COL32(r, g, b, 255);
+}
+
+// @brief Draws the zones of the last frame, one band per lane (thread) and one row per nesting depth
+static void drawFlameGraph(Profiler& profiler) {
+	const std::vector<ProfileRecord>& records = profiler.lastFrame();
+	uint64_t frameStart = profiler.lastFrameStart();
+	double frameDuration = static_cast<double>(std::max<uint64_t>(profiler.lastFrameEnd() - frameStart, 1));
+
+	// Find how deep each lane goes so every lane gets just enough rows
+	std::vector<uint32_t> laneDepths;
+	for (const ProfileRecord& record : records) {
+		if (record.lane >= laneDepths.size()) laneDepths.resize(record.lane + 1, 0);
+		laneDepths[record.lane] = std::max(laneDepths[record.lane], record.event.depth + 1);
+	}
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	float labelWidth = 80.0f;
+	float graphWidth = std::max(width - labelWidth, 10.0f);
+
+	std::vector<float> laneOffsets(laneDepths.size(), 0.0f);
+	float height = 0.0f;
+	for (size_t lane = 0; lane < laneDepths.size(); lane++) {
+		laneOffsets[lane] = height;
+		if (laneDepths[lane] == 0) continue;
+		drawList->AddText(ImVec2(origin.x, origin.y + height), IM_COL32(200, 200, 200, 255), profiler.laneName(static_cast<uint32_t>(lane)).c_str());
+		height += laneDepths[lane] * rowHeight + lanePadding;
+	}
+
+	const char* hoveredName = nullptr;
+	double hoveredMilliseconds = 0.0;
+	ImVec2 mouse = ImGui::GetIO().MousePos;
+	for (const ProfileRecord& record : records) {
+		// Zones that started before the frame (e.g. the one that called newFrame) are clipped to it
+		double start = record.event.start > frameStart ? static_cast<double>(record.event.start - frameStart) : 0.0;
+		double end = record.event.end > frameStart ? static_cast<double>(record.event.end - frameStart) : 0.0;
+		float x0 = origin.x + labelWidth + static_cast<float>(start / frameDuration) * graphWidth;
+		float x1 = origin.x + labelWidth + static_cast<float>(std::min(end / frameDuration, 1.0)) * graphWidth;
+		float y0 = origin.y + laneOffsets[record.lane] + record.event.depth * rowHeight;
+		if (record.event.instant) {
+			// Markers are a tick across their row
+			drawList->AddLine(ImVec2(x0, y0), ImVec2(x0, y0 + rowHeight - 1.0f), IM_COL32(255, 255, 255, 255));
+			continue;
+		}
+		ImVec2 min(x0, y0);
+		ImVec2 max(std::max(x1, x0 + 1.0f), y0 + rowHeight - 1.0f);
+
+		drawList->AddRectFilled(min, max, zoneColor(record.event.name));
+		// Only label zones wide enough to hold some text
+		if (max.x - min.x > 30.0f) {
+			drawList->PushClipRect(min, max, true);
+			drawList->AddText(ImVec2(min.x + 2.0f, min.y + 1.0f), IM_COL32(0, 0, 0, 255), record.event.name);
+			drawList->PopClipRect();
+		}
+		if (mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y) {
+			hoveredName = record.event.name;
+			hoveredMilliseconds = (record.event.end - record.event.start) * 1e-6;
+		}
+	}
+
+	ImGui::Dummy(ImVec2(width, std::max(height, rowHeight)));
+	if (hoveredName && ImGui::IsWindowHovered()) {
+		ImGui::SetTooltip("%s: %.3f ms", hoveredName, hoveredMilliseconds);
+	}
+}
+
+// @brief Table of every zone's rolling per-frame statistics, slowest first
+static void drawStatistics(Profiler& profiler) {
+	std::vector<std::pair<const std::string*, const ZoneStatistics*>> zones;
+	for (auto& [name, statistics] : profiler.statistics()) {
+		zones.emplace_back(&name, &statistics);
+	}
+	std::sort(zones.begin(), zones.end(), [](const auto& a, const auto& b) { return a.second->mean() > b.second->mean(); });
+
+	if (ImGui::BeginTable("Zone Statistics", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+		ImGui::TableSetupColumn("Zone");
+		ImGui::TableSetupColumn("Last (ms)");
+		ImGui::TableSetupColumn("Mean (ms)");
+		ImGui::TableSetupColumn("Max (ms)");
+		ImGui::TableSetupColumn("Calls");
+		ImGui::TableHeadersRow();
+		for (auto& [name, statistics] : zones) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::TextUnformatted(name->c_str());
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", statistics->last());
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", statistics->mean());
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", statistics->max());
+			ImGui::TableNextColumn(); ImGui::Text("%u", statistics->calls);
+		}
+		ImGui::EndTable();
+	}
+}
+
+void Profiler::addWidgets() {
+	Gui::getGui().addWidget("Profiler", [this]() {
+		bool enabled = this->enabled();
+		if (ImGui::Checkbox("Enabled", &enabled)) {
+			setEnabled(enabled);
+		}
+		ImGui::SameLine();
+		ImGui::Checkbox("Freeze", &_freezeView);
+		if (capturing()) {
+			ImGui::Text("Capturing to %s...", _capturePath.c_str());
+		}
+		else {
+			ImGui::DragInt("Frames", &_captureFrameCount, 1, 1, 10000);
+			ImGui::SameLine();
+			if (ImGui::Button("Capture Trace")) {
+				startCapture(_captureFrameCount, "profile_capture_" + std::to_string(_frameNumber) + ".json");
+			}
+			if (!_lastCapturePath.empty()) {
+				ImGui::Text("Last capture: %s", _lastCapturePath.c_str());
+			}
+		}
+		ImGui::Text("Frame: %.3f ms, %d zones, %llu dropped", (_lastFrameEnd - _lastFrameStart) * 1e-6, static_cast<int>(_lastFrame.size()),
+			static_cast<unsigned long long>(droppedEvents()));
+
+		if (ImGui::CollapsingHeader("Flame Graph", ImGuiTreeNodeFlags_DefaultOpen)) {
+			drawFlameGraph(*this);
+		}
+		if (ImGui::CollapsingHeader("Zones", ImGuiTreeNodeFlags_DefaultOpen)) {
+			drawStatistics(*this);
+		}
+	});
+}
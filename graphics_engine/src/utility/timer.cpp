@@ -5,7 +5,7 @@ Timer::Timer() :
 	_fps(0.0f),
 	_currentTime(std::chrono::steady_clock::now()) {}
 
-void Timer::update() {
+void Timer::update(bool countFrame) {
 	// get the current time
 	_newTime = std::chrono::steady_clock::now();
 
@@ -16,5 +16,9 @@ void Timer::update() {
 	float smoothing = 0.9f;
 	_fps = (_fps * smoothing) + (naivefps * (1.0f - smoothing));
 
+	if (countFrame) {
+		_statistics.endFrame(_frameTime * 1000.0);
+	}
+
 	_currentTime = _newTime;
 }
\ No newline at end of file